@@ -0,0 +1,504 @@
+#include "common.h"
+#include <string.h>
+
+// ============================================================================
+// Aztec Encoder - On-watch, compact (1-4 layers) and full-range symbols
+// The text is split into Upper/Lower/Mixed/Punct/Digit runs and binary-shift
+// segments by a shortest-bitstream search, bit-stuffed into 6/8/10/12-bit
+// codewords, protected with Reed-Solomon over GF(64/256/1024/4096) (the mode
+// message over GF(16)), and laid out in the standard spiral around the
+// bullseye. Error correction is 23% + 3 codewords, the bwip-js default the
+// config page uses. Working buffers live on the heap only while encoding.
+// ============================================================================
+
+enum { M_UPPER = 0, M_LOWER, M_MIXED, M_DIGIT, M_PUNCT, NUM_MODES };
+
+static const uint8_t MODE_BITS[NUM_MODES] = {5, 5, 5, 4, 5};
+
+// Cheapest latch between any two modes, as {code, bit count}: chains such as
+// Lower -> Upper (D/L U/L) are folded into one entry.
+static const struct { uint16_t code; uint8_t bits; } LATCH[NUM_MODES][NUM_MODES] = {
+    // to:  UPPER              LOWER              MIXED              DIGIT              PUNCT
+    { {0, 0},          {28, 5},           {29, 5},           {30, 5},           {29 << 5 | 30, 10} },  // UPPER
+    { {30 << 4 | 14, 9}, {0, 0},          {29, 5},           {30, 5},           {29 << 5 | 30, 10} },  // LOWER
+    { {29, 5},         {28, 5},           {0, 0},            {29 << 5 | 30, 10}, {30, 5} },            // MIXED
+    { {14, 4},         {14 << 5 | 28, 9}, {14 << 5 | 29, 9}, {0, 0},            {14 << 10 | 29 << 5 | 30, 14} },  // DIGIT
+    { {31, 5},         {31 << 5 | 28, 10}, {31 << 5 | 29, 10}, {31 << 5 | 30, 10}, {0, 0} },           // PUNCT
+};
+
+#define CODE_PS 0    // Punct shift (Upper/Lower/Mixed/Digit)
+#define CODE_US_LOWER 28
+#define CODE_US_DIGIT 15
+#define CODE_BS 31   // binary shift (Upper/Lower/Mixed)
+
+// Mixed-mode codes 20..27 and Punct-mode codes 6..30, in order.
+static const char MIXED_SYMBOLS[] = "@\\^_`|~\x7f";
+static const char PUNCT_SYMBOLS[] = "!\"#$%&'()*+,-./:;<=>?[]{}";
+
+// Code of byte c in `mode`, or -1 if the mode can't hold it.
+static int char_code(int mode, uint8_t c) {
+    switch (mode) {
+        case M_UPPER:
+            if (c == ' ') return 1;
+            return (c >= 'A' && c <= 'Z') ? c - 'A' + 2 : -1;
+        case M_LOWER:
+            if (c == ' ') return 1;
+            return (c >= 'a' && c <= 'z') ? c - 'a' + 2 : -1;
+        case M_DIGIT:
+            if (c == ' ') return 1;
+            if (c == ',') return 12;
+            if (c == '.') return 13;
+            return (c >= '0' && c <= '9') ? c - '0' + 2 : -1;
+        case M_MIXED:
+            if (c == ' ') return 1;
+            if (c >= 1 && c <= 13) return c + 1;
+            if (c >= 27 && c <= 31) return c - 27 + 15;
+            for (int i = 0; MIXED_SYMBOLS[i]; i++) if ((uint8_t)MIXED_SYMBOLS[i] == c) return 20 + i;
+            return -1;
+        default:
+            if (c == '\r') return 1;
+            for (int i = 0; PUNCT_SYMBOLS[i]; i++) if ((uint8_t)PUNCT_SYMBOLS[i] == c) return 6 + i;
+            return -1;
+    }
+}
+
+// --- Bit Buffer ---
+
+typedef struct {
+    uint8_t *buf;
+    int len;   // bits written
+} Bits;
+
+static void put_bits(Bits *b, uint32_t value, int n) {
+    for (int i = n - 1; i >= 0; i--, b->len++) {
+        if ((value >> i) & 1) b->buf[b->len >> 3] |= (uint8_t)(0x80 >> (b->len & 7));
+    }
+}
+
+static bool get_bit(const uint8_t *buf, int i) {
+    return (buf[i >> 3] >> (7 - (i & 7))) & 1;
+}
+
+// --- High-Level Encoding ---
+// Backward search over (position, mode) for the fewest bits, as in the
+// Code 128 encoder. From each state the next byte is coded directly, via a
+// Punct or Upper shift, or starts a binary-shift run of any length; one latch
+// may precede any of these. Costs and choices are kept for every position
+// because a binary run can jump arbitrarily far ahead.
+
+enum { ACT_CHAR = 0, ACT_SHIFT_P, ACT_SHIFT_U, ACT_BINARY };
+
+typedef struct {
+    uint8_t via;     // mode latched to before acting (== own mode: no latch)
+    uint8_t act;
+    uint8_t run;     // ACT_BINARY: bytes in the run
+} Step;
+
+#define COST_INF 0xFFFF
+
+static int binary_header_bits(int k) { return 5 + (k <= 31 ? 5 : 16); }
+
+// Bits to code s[i..] from `mode` without latching first; sets *out.
+static int base_cost(const uint8_t *s, int n, int i, int mode, const uint16_t *cost, Step *out) {
+    uint8_t c = s[i];
+    int best = COST_INF;
+    const uint16_t *next = cost + (i + 1) * NUM_MODES;
+
+    if (char_code(mode, c) >= 0 && next[mode] != COST_INF) {
+        best = MODE_BITS[mode] + next[mode];
+        *out = (Step){ (uint8_t)mode, ACT_CHAR, 0 };
+    }
+    if (mode != M_PUNCT && char_code(M_PUNCT, c) >= 0 && next[mode] != COST_INF &&
+        MODE_BITS[mode] + 5 + next[mode] < best) {
+        best = MODE_BITS[mode] + 5 + next[mode];
+        *out = (Step){ (uint8_t)mode, ACT_SHIFT_P, 0 };
+    }
+    if ((mode == M_LOWER || mode == M_DIGIT) && char_code(M_UPPER, c) >= 0 &&
+        next[mode] != COST_INF && MODE_BITS[mode] + 5 + next[mode] < best) {
+        best = MODE_BITS[mode] + 5 + next[mode];
+        *out = (Step){ (uint8_t)mode, ACT_SHIFT_U, 0 };
+    }
+    if (mode == M_UPPER || mode == M_LOWER || mode == M_MIXED) {
+        int max_run = n - i < 255 ? n - i : 255;
+        for (int k = 1; k <= max_run; k++) {
+            int rest = cost[(i + k) * NUM_MODES + mode];
+            if (rest == COST_INF) continue;
+            int total = binary_header_bits(k) + 8 * k + rest;
+            if (total < best) {
+                best = total;
+                *out = (Step){ (uint8_t)mode, ACT_BINARY, (uint8_t)k };
+            }
+        }
+    }
+    return best;
+}
+
+// Encode s[0..n) into `out` (zeroed, big enough for the returned bit count
+// bound). Returns the bit count, or -1 when out of memory.
+static int encode_text(const uint8_t *s, int n, Bits *out) {
+    uint16_t *cost = malloc((n + 1) * NUM_MODES * sizeof(uint16_t));
+    Step *steps = malloc(n * NUM_MODES * sizeof(Step));
+    if (!cost || !steps) {
+        free(cost);
+        free(steps);
+        return -1;
+    }
+
+    for (int m = 0; m < NUM_MODES; m++) cost[n * NUM_MODES + m] = 0;
+    for (int i = n - 1; i >= 0; i--) {
+        int base[NUM_MODES];
+        Step base_step[NUM_MODES];
+        for (int m = 0; m < NUM_MODES; m++) base[m] = base_cost(s, n, i, m, cost, &base_step[m]);
+        for (int m = 0; m < NUM_MODES; m++) {
+            int best = base[m];
+            Step st = base_step[m];
+            for (int t = 0; t < NUM_MODES; t++) {
+                if (t == m || base[t] == COST_INF) continue;
+                if (LATCH[m][t].bits + base[t] < best) {
+                    best = LATCH[m][t].bits + base[t];
+                    st = base_step[t];
+                }
+            }
+            cost[i * NUM_MODES + m] = (uint16_t)(best < COST_INF ? best : COST_INF);
+            steps[i * NUM_MODES + m] = st;
+        }
+    }
+
+    int total = cost[M_UPPER];
+    if (out->buf) {
+        int mode = M_UPPER;
+        for (int i = 0; i < n;) {
+            Step st = steps[i * NUM_MODES + mode];
+            if (st.via != mode) {
+                put_bits(out, LATCH[mode][st.via].code, LATCH[mode][st.via].bits);
+                mode = st.via;
+            }
+            uint8_t c = s[i];
+            switch (st.act) {
+                case ACT_CHAR:
+                    put_bits(out, char_code(mode, c), MODE_BITS[mode]);
+                    i++;
+                    break;
+                case ACT_SHIFT_P:
+                    put_bits(out, CODE_PS, MODE_BITS[mode]);
+                    put_bits(out, char_code(M_PUNCT, c), 5);
+                    i++;
+                    break;
+                case ACT_SHIFT_U:
+                    put_bits(out, mode == M_LOWER ? CODE_US_LOWER : CODE_US_DIGIT, MODE_BITS[mode]);
+                    put_bits(out, char_code(M_UPPER, c), 5);
+                    i++;
+                    break;
+                default:
+                    put_bits(out, CODE_BS, 5);
+                    if (st.run <= 31) put_bits(out, st.run, 5);
+                    else put_bits(out, st.run - 31, 16);
+                    for (int k = 0; k < st.run; k++) put_bits(out, s[i + k], 8);
+                    i += st.run;
+                    break;
+            }
+        }
+    }
+    free(cost);
+    free(steps);
+    return total;
+}
+
+// --- Symbol Geometry ---
+
+static int total_bits_in_layers(int layers, bool compact) {
+    return ((compact ? 88 : 112) + 16 * layers) * layers;
+}
+
+static int word_size(int layers) {
+    return layers <= 2 ? 6 : layers <= 8 ? 8 : layers <= 22 ? 10 : 12;
+}
+
+// Primitive polynomials for each codeword size.
+static uint16_t field_poly(int bits) {
+    switch (bits) {
+        case 4:  return 0x13;
+        case 6:  return 0x43;
+        case 8:  return 0x12D;
+        case 10: return 0x409;
+        default: return 0x1069;
+    }
+}
+
+// Stuff the bit stream into `bits`-wide words: a word whose top bits-1 are
+// all equal gets the opposite last bit, and that data bit moves to the next
+// word. The tail is padded with 1s. Returns the word count, or -1 if more
+// than max_words would be needed (words may be NULL to just count).
+static int stuff_bits(const uint8_t *stream, int n, int bits, uint16_t *words, int max_words) {
+    int count = 0;
+    uint16_t mask = (uint16_t)((1 << bits) - 2);
+    for (int i = 0; i < n; i += bits) {
+        uint16_t w = 0;
+        for (int j = 0; j < bits; j++) {
+            if (i + j >= n || get_bit(stream, i + j)) w |= (uint16_t)(1 << (bits - 1 - j));
+        }
+        if ((w & mask) == mask) {
+            w &= mask;
+            i--;
+        } else if ((w & mask) == 0) {
+            w |= 1;
+            i--;
+        }
+        if (count >= max_words) return -1;
+        if (words) words[count] = w;
+        count++;
+    }
+    return count;
+}
+
+// --- Reed-Solomon over GF(2^bits) ---
+// Shift-and-add multiply: GF(1024)/GF(4096) log tables would cost 4-16 KB of
+// RAM, which the watch can't spare for a one-off encode.
+
+static uint16_t gf_mul(uint16_t a, uint16_t b, int bits, uint16_t poly) {
+    uint16_t r = 0;
+    uint16_t top = (uint16_t)(1 << bits);
+    while (b) {
+        if (b & 1) r ^= a;
+        b >>= 1;
+        a <<= 1;
+        if (a & top) a ^= poly;
+    }
+    return r;
+}
+
+#define RS_STACK_GEN 8
+
+// words[0..data) are the message; fill words[data..total) with check words.
+// Generator roots are alpha^1 .. alpha^ec (Aztec's generator base is 1). A
+// short generator (the mode message's 5-6 check words) lives on the stack, so
+// only the data check words can fail for lack of memory.
+static bool rs_encode(uint16_t *words, int data, int total, int bits) {
+    int ec = total - data;
+    uint16_t poly = field_poly(bits);
+    uint16_t stack_gen[RS_STACK_GEN];
+    uint16_t *gen = ec < RS_STACK_GEN ? stack_gen : malloc((ec + 1) * sizeof(uint16_t));
+    if (!gen) return false;
+
+    // gen[0] is the highest coefficient (1); multiply in (x - alpha^i).
+    memset(gen, 0, (ec + 1) * sizeof(uint16_t));
+    gen[0] = 1;
+    uint16_t root = 1;
+    for (int i = 1; i <= ec; i++) {
+        root = gf_mul(root, 2, bits, poly);
+        for (int j = i; j > 0; j--) gen[j] ^= gf_mul(gen[j - 1], root, bits, poly);
+    }
+
+    uint16_t *rem = words + data;
+    memset(rem, 0, ec * sizeof(uint16_t));
+    for (int i = 0; i < data; i++) {
+        uint16_t factor = words[i] ^ rem[0];
+        memmove(rem, rem + 1, (ec - 1) * sizeof(uint16_t));
+        rem[ec - 1] = 0;
+        if (factor == 0) continue;
+        for (int j = 0; j < ec; j++) rem[j] ^= gf_mul(gen[j + 1], factor, bits, poly);
+    }
+    if (gen != stack_gen) free(gen);
+    return true;
+}
+
+// --- Matrix ---
+
+typedef struct {
+    uint8_t *out;
+    int size;
+} Symbol;
+
+static void set_dark(Symbol *sym, int x, int y) {
+    int idx = y * sym->size + x;
+    sym->out[idx >> 3] |= (uint8_t)(0x80 >> (idx & 7));
+}
+
+static void draw_bullseye(Symbol *sym, int center, int size) {
+    for (int i = 0; i < size; i += 2) {
+        for (int j = center - i; j <= center + i; j++) {
+            set_dark(sym, j, center - i);
+            set_dark(sym, j, center + i);
+            set_dark(sym, center - i, j);
+            set_dark(sym, center + i, j);
+        }
+    }
+    // Orientation marks: 3, 2, 1 and 0 dark modules clockwise from top-left.
+    set_dark(sym, center - size, center - size);
+    set_dark(sym, center - size + 1, center - size);
+    set_dark(sym, center - size, center - size + 1);
+    set_dark(sym, center + size, center - size);
+    set_dark(sym, center + size, center - size + 1);
+    set_dark(sym, center + size, center + size - 1);
+}
+
+// Mode message (layers, data words, GF(16) check words) clockwise around the
+// bullseye from its top-left corner.
+static void draw_mode_message(Symbol *sym, bool compact, int layers, int data_words) {
+    uint16_t words[10];
+    int data = compact ? 2 : 4, total = compact ? 7 : 10;
+    uint32_t value = compact ? (uint32_t)((layers - 1) << 6 | (data_words - 1))
+                             : (uint32_t)((layers - 1) << 11 | (data_words - 1));
+    for (int i = 0; i < data; i++) words[i] = (value >> (4 * (data - 1 - i))) & 0xF;
+    rs_encode(words, data, total, 4);   // 5-6 check words: a stack generator, can't fail
+
+    uint8_t msg[5] = {0};
+    Bits b = { msg, 0 };
+    for (int i = 0; i < total; i++) put_bits(&b, words[i], 4);
+
+    int center = sym->size / 2;
+    if (compact) {
+        for (int i = 0; i < 7; i++) {
+            int offset = center - 3 + i;
+            if (get_bit(msg, i)) set_dark(sym, offset, center - 5);
+            if (get_bit(msg, i + 7)) set_dark(sym, center + 5, offset);
+            if (get_bit(msg, 20 - i)) set_dark(sym, offset, center + 5);
+            if (get_bit(msg, 27 - i)) set_dark(sym, center - 5, offset);
+        }
+    } else {
+        for (int i = 0; i < 10; i++) {
+            int offset = center - 5 + i + i / 5;   // skips the reference grid line
+            if (get_bit(msg, i)) set_dark(sym, offset, center - 7);
+            if (get_bit(msg, i + 10)) set_dark(sym, center + 7, offset);
+            if (get_bit(msg, 29 - i)) set_dark(sym, offset, center + 7);
+            if (get_bit(msg, 39 - i)) set_dark(sym, center - 7, offset);
+        }
+    }
+}
+
+// --- Public API ---
+
+// Encode `text` (bytes) as the smallest Aztec symbol with 23% + 3 check words
+// whose packed matrix fits in `out_len` bytes. Output is the usual MSB-first
+// packed square; returns false if it doesn't fit or memory runs out.
+bool aztec_encode(const char *text, uint8_t *out, int out_len, uint8_t *out_size) {
+    const uint8_t *s = (const uint8_t *)text;
+    int n = text ? strlen(text) : 0;
+    if (n == 0 || n > MAX_TEXT_LEN) return false;
+
+    // 1. Shortest bit stream.
+    Bits stream = { NULL, 0 };
+    int nbits = encode_text(s, n, &stream);
+    if (nbits < 0) return false;
+    stream.buf = malloc((nbits + 7) / 8);
+    if (!stream.buf) return false;
+    memset(stream.buf, 0, (nbits + 7) / 8);
+    if (encode_text(s, n, &stream) < 0) {   // its DP buffers can fail this time
+        free(stream.buf);
+        return false;
+    }
+
+    // 2. Smallest symbol: compact 1-4 layers, then full from 4 (full 1-3 hold
+    //    less than compact 4). Data words must leave room for the check words.
+    bool compact = true;
+    int layers = 0, bits = 0, data_words = 0, size = 0;
+    for (int i = 0; i < 4 + 32 - 3; i++) {
+        bool c = i < 4;
+        int l = c ? i + 1 : i;
+        int sz;
+        if (c) {
+            sz = 11 + 4 * l;
+        } else {
+            int base = 14 + 4 * l;
+            sz = base + 1 + 2 * ((base / 2 - 1) / 15);
+        }
+        if ((sz * sz + 7) / 8 > out_len) break;
+        int ws = word_size(l);
+        int total = total_bits_in_layers(l, c) / ws;
+        int dw = stuff_bits(stream.buf, nbits, ws, NULL, total);
+        if (dw < 0 || (c && dw > 64)) continue;
+        if (total - dw >= (dw * 23 + 99) / 100 + 3) {
+            compact = c;
+            layers = l;
+            bits = ws;
+            data_words = dw;
+            size = sz;
+            break;
+        }
+    }
+    if (layers == 0) {
+        free(stream.buf);
+        return false;
+    }
+
+    // 3. Codewords: stuffed data, then check words.
+    int layer_bits = total_bits_in_layers(layers, compact);
+    int total_words = layer_bits / bits;
+    uint16_t *words = malloc(total_words * sizeof(uint16_t));
+    if (!words) {
+        free(stream.buf);
+        return false;
+    }
+    stuff_bits(stream.buf, nbits, bits, words, total_words);
+    free(stream.buf);
+    if (!rs_encode(words, data_words, total_words, bits)) {
+        free(words);
+        return false;
+    }
+
+    // 4. Layout. Data layers run outermost first; in a full symbol the module
+    //    coordinates skip the reference grid lines every 16 modules.
+    Symbol sym = { out, size };
+    memset(out, 0, (size * size + 7) / 8);
+    int base = (compact ? 11 : 14) + layers * 4;
+    uint8_t *map = malloc(base);
+    if (!map) {
+        free(words);
+        return false;
+    }
+    if (compact) {
+        for (int i = 0; i < base; i++) map[i] = (uint8_t)i;
+    } else {
+        int orig_center = base / 2, center = size / 2;
+        for (int i = 0; i < orig_center; i++) {
+            int offset = i + i / 15;
+            map[orig_center - i - 1] = (uint8_t)(center - offset - 1);
+            map[orig_center + i] = (uint8_t)(center + offset + 1);
+        }
+    }
+
+    // Bit k of the message: leading zero padding, then the words MSB first.
+    int pad = layer_bits % bits;
+#define MSG_BIT(k) ((k) >= pad && ((words[((k) - pad) / bits] >> (bits - 1 - ((k) - pad) % bits)) & 1))
+    for (int i = 0, row_offset = 0; i < layers; i++) {
+        int row_size = (layers - i) * 4 + (compact ? 9 : 12);
+        int low = i * 2, high = base - 1 - low;
+        for (int j = 0; j < row_size; j++) {
+            int col_offset = j * 2;
+            for (int k = 0; k < 2; k++) {
+                if (MSG_BIT(row_offset + col_offset + k))
+                    set_dark(&sym, map[low + k], map[low + j]);
+                if (MSG_BIT(row_offset + row_size * 2 + col_offset + k))
+                    set_dark(&sym, map[low + j], map[high - k]);
+                if (MSG_BIT(row_offset + row_size * 4 + col_offset + k))
+                    set_dark(&sym, map[high - k], map[high - j]);
+                if (MSG_BIT(row_offset + row_size * 6 + col_offset + k))
+                    set_dark(&sym, map[high - j], map[low + k]);
+            }
+        }
+        row_offset += row_size * 8;
+    }
+#undef MSG_BIT
+    free(map);
+    free(words);
+
+    draw_mode_message(&sym, compact, layers, data_words);
+    int center = size / 2;
+    if (compact) {
+        draw_bullseye(&sym, center, 5);
+    } else {
+        draw_bullseye(&sym, center, 7);
+        // Reference grid: alternating lines through the centre every 16 modules.
+        for (int i = 0, j = 0; i < base / 2 - 1; i += 15, j += 16) {
+            for (int k = center & 1; k < size; k += 2) {
+                set_dark(&sym, center - j, k);
+                set_dark(&sym, center + j, k);
+                set_dark(&sym, k, center - j);
+                set_dark(&sym, k, center + j);
+            }
+        }
+    }
+
+    *out_size = (uint8_t)size;
+    return true;
+}
@@ -2,270 +2,186 @@
 #include <string.h>
 
 // ============================================================================
-// Code 128 Barcode Rendering (our original implementation)
-// Supports Code 128B (alphanumeric) and Code 128C (numeric pairs)
+// Frame Buffer Blitter
+// A big PDF417 or QR is thousands of dark modules, and graphics_fill_rect runs
+// the full clip/composite pipeline for every one of them, so the code visibly
+// paints in. The renderers below instead capture the frame buffer once and
+// write black spans straight into it: runs of whole bytes (memset) on 8-bit
+// displays (basalt/chalk/emery), 8 pixels per byte on 1-bit ones (aplite/
+// diorite). If the buffer can't be captured they fall back to fill_rect.
+// Rects are in frame-buffer coordinates: the barcode layer fills its window.
 // ============================================================================
 
-static const uint8_t CODE128_PATTERNS[][6] = {
-    {2, 1, 2, 2, 2, 2}, // 0: Space
-    {2, 2, 2, 1, 2, 2}, // 1: !
-    {2, 2, 2, 2, 2, 1}, // 2: "
-    {1, 2, 1, 2, 2, 3}, // 3: #
-    {1, 2, 1, 3, 2, 2}, // 4: $
-    {1, 3, 1, 2, 2, 2}, // 5: %
-    {1, 2, 2, 2, 1, 3}, // 6: &
-    {1, 2, 2, 3, 1, 2}, // 7: '
-    {1, 3, 2, 2, 1, 2}, // 8: (
-    {2, 2, 1, 2, 1, 3}, // 9: )
-    {2, 2, 1, 3, 1, 2}, // 10: *
-    {2, 3, 1, 2, 1, 2}, // 11: +
-    {1, 1, 2, 2, 3, 2}, // 12: ,
-    {1, 2, 2, 1, 3, 2}, // 13: -
-    {1, 2, 2, 2, 3, 1}, // 14: .
-    {1, 1, 3, 2, 2, 2}, // 15: /
-    {1, 2, 3, 1, 2, 2}, // 16: 0
-    {1, 2, 3, 2, 2, 1}, // 17: 1
-    {2, 2, 3, 2, 1, 1}, // 18: 2
-    {2, 2, 1, 1, 3, 2}, // 19: 3
-    {2, 2, 1, 2, 3, 1}, // 20: 4
-    {2, 1, 3, 2, 1, 2}, // 21: 5
-    {2, 2, 3, 1, 1, 2}, // 22: 6
-    {3, 1, 2, 1, 3, 1}, // 23: 7
-    {3, 1, 1, 2, 2, 2}, // 24: 8
-    {3, 2, 1, 1, 2, 2}, // 25: 9
-    {3, 2, 1, 2, 2, 1}, // 26: :
-    {3, 1, 2, 2, 1, 2}, // 27: ;
-    {3, 2, 2, 1, 1, 2}, // 28: <
-    {3, 2, 2, 2, 1, 1}, // 29: =
-    {2, 1, 2, 1, 2, 3}, // 30: >
-    {2, 1, 2, 3, 2, 1}, // 31: ?
-    {2, 3, 2, 1, 2, 1}, // 32: @
-    {1, 1, 1, 3, 2, 3}, // 33: A
-    {1, 3, 1, 1, 2, 3}, // 34: B
-    {1, 3, 1, 3, 2, 1}, // 35: C
-    {1, 1, 2, 3, 1, 3}, // 36: D
-    {1, 3, 2, 1, 1, 3}, // 37: E
-    {1, 3, 2, 3, 1, 1}, // 38: F
-    {2, 1, 1, 3, 1, 3}, // 39: G
-    {2, 3, 1, 1, 1, 3}, // 40: H
-    {2, 3, 1, 3, 1, 1}, // 41: I
-    {1, 1, 2, 1, 3, 3}, // 42: J
-    {1, 1, 2, 3, 3, 1}, // 43: K
-    {1, 3, 2, 1, 3, 1}, // 44: L
-    {1, 1, 3, 1, 2, 3}, // 45: M
-    {1, 1, 3, 3, 2, 1}, // 46: N
-    {1, 3, 3, 1, 2, 1}, // 47: O
-    {3, 1, 3, 1, 2, 1}, // 48: P
-    {2, 1, 1, 3, 3, 1}, // 49: Q
-    {2, 3, 1, 1, 3, 1}, // 50: R
-    {2, 1, 3, 1, 1, 3}, // 51: S
-    {2, 1, 3, 3, 1, 1}, // 52: T
-    {2, 1, 3, 1, 3, 1}, // 53: U
-    {3, 1, 1, 1, 2, 3}, // 54: V
-    {3, 1, 1, 3, 2, 1}, // 55: W
-    {3, 3, 1, 1, 2, 1}, // 56: X
-    {3, 1, 2, 1, 1, 3}, // 57: Y
-    {3, 1, 2, 3, 1, 1}, // 58: Z
-    {3, 3, 2, 1, 1, 1}, // 59: [
-    {3, 1, 4, 1, 1, 1}, // 60: backslash
-    {2, 2, 1, 4, 1, 1}, // 61: ]
-    {4, 3, 1, 1, 1, 1}, // 62: ^
-    {1, 1, 1, 2, 2, 4}, // 63: _
-    {1, 1, 1, 4, 2, 2}, // 64: `
-    {1, 2, 1, 1, 2, 4}, // 65: a
-    {1, 2, 1, 4, 2, 1}, // 66: b
-    {1, 4, 1, 1, 2, 2}, // 67: c
-    {1, 4, 1, 2, 2, 1}, // 68: d
-    {1, 1, 2, 2, 1, 4}, // 69: e
-    {1, 1, 2, 4, 1, 2}, // 70: f
-    {1, 2, 2, 1, 1, 4}, // 71: g
-    {1, 2, 2, 4, 1, 1}, // 72: h
-    {1, 4, 2, 1, 1, 2}, // 73: i
-    {1, 4, 2, 2, 1, 1}, // 74: j
-    {2, 4, 1, 2, 1, 1}, // 75: k
-    {2, 2, 1, 1, 1, 4}, // 76: l
-    {4, 1, 3, 1, 1, 1}, // 77: m
-    {2, 4, 1, 1, 1, 2}, // 78: n
-    {1, 3, 4, 1, 1, 1}, // 79: o
-    {1, 1, 1, 2, 4, 2}, // 80: p
-    {1, 2, 1, 1, 4, 2}, // 81: q
-    {1, 2, 1, 2, 4, 1}, // 82: r
-    {1, 1, 4, 2, 1, 2}, // 83: s
-    {1, 2, 4, 1, 1, 2}, // 84: t
-    {1, 2, 4, 2, 1, 1}, // 85: u
-    {4, 1, 1, 2, 1, 2}, // 86: v
-    {4, 2, 1, 1, 1, 2}, // 87: w
-    {4, 2, 1, 2, 1, 1}, // 88: x
-    {2, 1, 2, 1, 4, 1}, // 89: y
-    {2, 1, 4, 1, 2, 1}, // 90: z
-    {4, 1, 2, 1, 2, 1}, // 91: {
-    {1, 1, 1, 1, 4, 3}, // 92: |
-    {1, 1, 1, 3, 4, 1}, // 93: }
-    {1, 3, 1, 1, 4, 1}, // 94: ~
-    {1, 1, 4, 1, 1, 3}, // 95: DEL
-    {1, 1, 4, 3, 1, 1}, // 96: FNC3
-    {4, 1, 1, 1, 1, 3}, // 97: FNC2
-    {4, 1, 1, 3, 1, 1}, // 98: SHIFT
-    {1, 1, 3, 1, 4, 1}, // 99: Code C
-    {1, 1, 4, 1, 3, 1}, // 100: Code B / FNC4
-    {3, 1, 1, 1, 4, 1}, // 101: Code A / FNC4
-    {4, 1, 1, 1, 3, 1}, // 102: FNC1
-    {2, 1, 1, 4, 1, 2}, // 103: Start A
-    {2, 1, 1, 2, 1, 4}, // 104: Start B
-    {2, 1, 1, 2, 3, 2}, // 105: Start C
-};
-
-static const uint8_t CODE128_STOP[] = {2, 3, 3, 1, 1, 1, 2};
-
-// --- Helpers ---
-
-static void draw_bar(GContext *ctx, int x, int y, int width, int height, bool black) {
-    graphics_context_set_fill_color(ctx, black ? GColorBlack : GColorWhite);
-    graphics_fill_rect(ctx, GRect(x, y, width, height), 0, GCornerNone);
+typedef struct {
+    GContext *ctx;      // NULL when drawing into an offscreen bitmap
+    GBitmap *fb;        // captured frame buffer, or NULL = graphics_fill_rect
+    bool one_bit;       // GBitmapFormat1Bit: 1 bit/pixel, LSB = leftmost, 0 = black
+    uint8_t *data;      // 1-bit rows (rectangular, fixed stride)
+    int stride;
+    GRect box;          // frame buffer bounds, for clipping
+} Canvas;
+
+static void canvas_begin(Canvas *cv, GContext *ctx) {
+    memset(cv, 0, sizeof(*cv));
+    cv->ctx = ctx;
+    cv->fb = graphics_capture_frame_buffer(ctx);
+    if (!cv->fb) return;
+    cv->box = gbitmap_get_bounds(cv->fb);
+    cv->one_bit = (gbitmap_get_format(cv->fb) == GBitmapFormat1Bit);
+    cv->data = gbitmap_get_data(cv->fb);
+    cv->stride = gbitmap_get_bytes_per_row(cv->fb);
 }
 
-static bool is_all_digits(const char *str) {
-    for (int i = 0; str[i]; i++) {
-        if (str[i] < '0' || str[i] > '9') return false;
-    }
-    return true;
+// Target an offscreen 1-bit bitmap instead of the screen (see the cache below).
+static void canvas_begin_bitmap(Canvas *cv, GBitmap *bmp) {
+    memset(cv, 0, sizeof(*cv));
+    cv->fb = bmp;
+    cv->box = gbitmap_get_bounds(bmp);
+    cv->one_bit = true;
+    cv->data = gbitmap_get_data(bmp);
+    cv->stride = gbitmap_get_bytes_per_row(bmp);
 }
 
-static int get_code128_value(char c) {
-    if (c >= 32 && c <= 127) return c - 32;
-    return 0;
+static void canvas_end(Canvas *cv) {
+    if (cv->fb && cv->ctx) graphics_release_frame_buffer(cv->ctx, cv->fb);
+    cv->fb = NULL;
 }
 
-static int calculate_code128_checksum(const char *data) {
-    int checksum = 104; // Start B
-    int len = strlen(data);
-    for (int i = 0; i < len && i < MAX_DATA_LEN; i++) {
-        checksum += get_code128_value(data[i]) * (i + 1);
+// Clear bits [x0, x1) of a 1-bit row to black: masked edge bytes, memset between.
+static void span_1bit(uint8_t *row, int x0, int x1) {
+    int b0 = x0 >> 3, b1 = (x1 - 1) >> 3;
+    uint8_t head = (uint8_t)(0xFF << (x0 & 7));
+    uint8_t tail = (uint8_t)(0xFF >> (7 - ((x1 - 1) & 7)));
+    if (b0 == b1) {
+        row[b0] &= (uint8_t)~(head & tail);
+        return;
     }
-    return checksum % 103;
+    row[b0] &= (uint8_t)~head;
+    if (b1 - b0 > 1) memset(row + b0 + 1, 0x00, b1 - b0 - 1);
+    row[b1] &= (uint8_t)~tail;
 }
 
-static int calculate_code128c_checksum(const char *data) {
-    int checksum = 105; // Start C
-    int len = strlen(data);
-    int pos = 1;
-    for (int i = 0; i < len; i += 2) {
-        int value = (data[i] - '0') * 10;
-        if (i + 1 < len) value += (data[i + 1] - '0');
-        checksum += value * pos;
-        pos++;
+// Fill a black rectangle. The only primitive the module renderers use.
+static void canvas_fill(Canvas *cv, int x, int y, int w, int h) {
+    if (w <= 0 || h <= 0) return;
+    if (!cv->fb) {
+        graphics_fill_rect(cv->ctx, GRect(x, y, w, h), 0, GCornerNone);
+        return;
     }
-    return checksum % 103;
-}
-
-// --- Code 128 Barcode Drawing ---
 
-static void draw_code128_barcode(GContext *ctx, GRect bounds, const char *data) {
-    int data_len = strlen(data);
-    if (data_len == 0 || data_len > MAX_DATA_LEN) return;
+    int x0 = x, x1 = x + w, y0 = y, y1 = y + h;
+    int bx1 = cv->box.origin.x + cv->box.size.w;
+    int by1 = cv->box.origin.y + cv->box.size.h;
+    if (x0 < cv->box.origin.x) x0 = cv->box.origin.x;
+    if (y0 < cv->box.origin.y) y0 = cv->box.origin.y;
+    if (x1 > bx1) x1 = bx1;
+    if (y1 > by1) y1 = by1;
+    if (x0 >= x1 || y0 >= y1) return;
+
+    if (cv->one_bit) {
+        for (int row = y0; row < y1; row++) {
+            span_1bit(cv->data + row * cv->stride, x0, x1);
+        }
+        return;
+    }
 
-    bool is_numeric = is_all_digits(data);
-    bool use_code_c = is_numeric;
+#if defined(PBL_COLOR)
+    // 8-bit: one byte per pixel. Round displays have a per-row visible range.
+    for (int row = y0; row < y1; row++) {
+        GBitmapDataRowInfo info = gbitmap_get_data_row_info(cv->fb, row);
+        int sx0 = x0 > info.min_x ? x0 : info.min_x;
+        int sx1 = x1 < info.max_x + 1 ? x1 : info.max_x + 1;
+        if (sx0 < sx1) memset(info.data + sx0, GColorBlack.argb, sx1 - sx0);
+    }
+#endif
+}
 
-    char padded_data[MAX_DATA_LEN + 2];
-    const char *barcode_data = data;
-    int barcode_len = data_len;
+// ============================================================================
+// Rectangle Coalescing
+// Dark modules are merged before they reach the canvas: each matrix row is cut
+// into horizontal runs ("spans"), and a span identical to one on the row above
+// extends that rectangle downwards instead of starting a new one. PDF417 rows
+// repeat 3-4 times and QR/Aztec finders and timing lines are solid, so real
+// symbols need an order of magnitude fewer fills than one per module.
+// Works in module coordinates; a Layout maps the finished rects to the screen.
+// ============================================================================
 
-    if (is_numeric && (data_len % 2 == 1)) {
-        padded_data[0] = '0';
-        strncpy(padded_data + 1, data, MAX_DATA_LEN);
-        padded_data[MAX_DATA_LEN + 1] = '\0';
-        barcode_data = padded_data;
-        barcode_len = data_len + 1;
+typedef struct {
+    int ox, oy;        // screen position of module (0, 0)
+    int mod_w, mod_h;  // module size in px (mod_h ignored when rows stretch)
+    int rows;          // matrix height
+    int stretch_h;     // > 0: rows stretched to fill this many px (PDF417)
+    bool rotate;       // 90 degrees: matrix row r -> screen column (rows-1-r)
+} Layout;
+
+// Open rectangle: the run [c0, c1) of dark modules, repeated since row r0.
+typedef struct { uint16_t c0, c1, r0; } Span;
+
+// Bounded so a pathological matrix can't blow the budget: spans beyond this
+// on a row are drawn as single-row rects instead of being merged.
+#define MAX_SPANS 64
+static Span s_open[MAX_SPANS];
+static Span s_next[MAX_SPANS];
+
+// Fill matrix rows [r0, r1) x columns [c0, c1) via the layout.
+static void layout_fill(Canvas *cv, const Layout *l, int c0, int c1, int r0, int r1) {
+    int y0, y1;
+    if (l->stretch_h > 0) {
+        y0 = l->oy + (r0 * l->stretch_h) / l->rows;
+        y1 = l->oy + (r1 * l->stretch_h) / l->rows;
+        if (y1 <= y0) y1 = y0 + 1;
+    } else {
+        y0 = l->oy + r0 * l->mod_h;
+        y1 = l->oy + r1 * l->mod_h;
     }
-
-    int bar_modules;
-    if (use_code_c) {
-        int pairs = barcode_len / 2;
-        bar_modules = 11 + (pairs * 11) + 11 + 13;
+    if (l->rotate) {
+        // Row axis runs right-to-left across the screen, columns run down it.
+        canvas_fill(cv, l->ox + (l->rows - r1) * l->mod_w, l->oy + c0 * l->mod_w,
+                    (r1 - r0) * l->mod_w, (c1 - c0) * l->mod_w);
     } else {
-        bar_modules = 11 + (barcode_len * 11) + 11 + 13;
+        canvas_fill(cv, l->ox + c0 * l->mod_w, y0, (c1 - c0) * l->mod_w, y1 - y0);
     }
+}
 
-    int bar_height = bounds.size.h - 50;
-    int bar_y = bounds.origin.y + 25;
-    int screen_margin = 6;
-    int available_width = bounds.size.w - (screen_margin * 2);
-    int module_width = available_width / bar_modules;
-    if (module_width < 1) module_width = 1;
-
-    int barcode_width = bar_modules * module_width;
-    int start_x = bounds.origin.x + screen_margin + (available_width - barcode_width) / 2;
-    if (start_x < bounds.origin.x + screen_margin) start_x = bounds.origin.x + screen_margin;
-    int right_limit = bounds.origin.x + bounds.size.w - screen_margin;
-
-    // White background
-    graphics_context_set_fill_color(ctx, GColorWhite);
-    graphics_fill_rect(ctx, GRect(bounds.origin.x + screen_margin, bar_y - 5, available_width, bar_height + 10), 0, GCornerNone);
-
-    int x = start_x;
-
-    if (use_code_c) {
-        // Start C (index 105)
-        for (int i = 0; i < 6 && x < right_limit; i++) {
-            int w = CODE128_PATTERNS[105][i] * module_width;
-            if (x + w > right_limit) w = right_limit - x;
-            draw_bar(ctx, x, bar_y, w, bar_height, (i % 2 == 0));
-            x += w;
-        }
-        // Digit pairs
-        for (int i = 0; i < barcode_len && x < right_limit; i += 2) {
-            int value = (barcode_data[i] - '0') * 10;
-            if (i + 1 < barcode_len) value += (barcode_data[i + 1] - '0');
-            for (int j = 0; j < 6 && x < right_limit; j++) {
-                int w = CODE128_PATTERNS[value][j] * module_width;
-                if (x + w > right_limit) w = right_limit - x;
-                draw_bar(ctx, x, bar_y, w, bar_height, (j % 2 == 0));
-                x += w;
+static void draw_coalesced(Canvas *cv, const Layout *l, uint16_t w, uint16_t h,
+                           const uint8_t *bits, int max_bytes) {
+    int n_open = 0;
+    for (int r = 0; r <= (int)h; r++) {
+        // 1. Cut row r into dark spans (the sentinel row h has none).
+        int n_next = 0;
+        int run = -1;
+        for (int c = 0; r < (int)h && c <= (int)w; c++) {
+            bool dark = false;
+            if (c < (int)w) {
+                int bit_idx = r * (int)w + c;
+                if ((bit_idx >> 3) >= max_bytes) break;   // never read past buffer
+                dark = bits[bit_idx >> 3] & (1 << (7 - (bit_idx & 7)));
             }
-        }
-        // Checksum
-        int checksum = calculate_code128c_checksum(barcode_data);
-        for (int i = 0; i < 6 && x < right_limit; i++) {
-            int w = CODE128_PATTERNS[checksum][i] * module_width;
-            if (x + w > right_limit) w = right_limit - x;
-            draw_bar(ctx, x, bar_y, w, bar_height, (i % 2 == 0));
-            x += w;
-        }
-    } else {
-        // Start B (index 104)
-        for (int i = 0; i < 6 && x < right_limit; i++) {
-            int w = CODE128_PATTERNS[104][i] * module_width;
-            if (x + w > right_limit) w = right_limit - x;
-            draw_bar(ctx, x, bar_y, w, bar_height, (i % 2 == 0));
-            x += w;
-        }
-        // Data characters
-        for (int i = 0; i < barcode_len && x < right_limit; i++) {
-            int value = get_code128_value(barcode_data[i]);
-            for (int j = 0; j < 6 && x < right_limit; j++) {
-                int w = CODE128_PATTERNS[value][j] * module_width;
-                if (x + w > right_limit) w = right_limit - x;
-                draw_bar(ctx, x, bar_y, w, bar_height, (j % 2 == 0));
-                x += w;
+            if (dark) {
+                if (run < 0) run = c;
+            } else if (run >= 0) {
+                if (n_next < MAX_SPANS) {
+                    s_next[n_next++] = (Span){ (uint16_t)run, (uint16_t)c, (uint16_t)r };
+                } else {
+                    layout_fill(cv, l, run, c, r, r + 1);
+                }
+                run = -1;
             }
         }
-        // Checksum
-        int checksum = calculate_code128_checksum(barcode_data);
-        for (int i = 0; i < 6 && x < right_limit; i++) {
-            int w = CODE128_PATTERNS[checksum][i] * module_width;
-            if (x + w > right_limit) w = right_limit - x;
-            draw_bar(ctx, x, bar_y, w, bar_height, (i % 2 == 0));
-            x += w;
-        }
-    }
 
-    // Stop pattern
-    for (int i = 0; i < 7 && x < right_limit; i++) {
-        int w = CODE128_STOP[i] * module_width;
-        if (x + w > right_limit) w = right_limit - x;
-        draw_bar(ctx, x, bar_y, w, bar_height, (i % 2 == 0));
-        x += w;
+        // 2. Both lists are sorted by column: a span that exactly matches an
+        //    open one inherits its start row, open ones left unmatched end here.
+        int j = 0;
+        for (int i = 0; i < n_open; i++) {
+            while (j < n_next && s_next[j].c0 < s_open[i].c0) j++;
+            if (j < n_next && s_next[j].c0 == s_open[i].c0 && s_next[j].c1 == s_open[i].c1) {
+                s_next[j].r0 = s_open[i].r0;
+            } else {
+                layout_fill(cv, l, s_open[i].c0, s_open[i].c1, s_open[i].r0, r);
+            }
+        }
+        memcpy(s_open, s_next, n_next * sizeof(Span));
+        n_open = n_next;
     }
 }
 
@@ -282,7 +198,7 @@ static void draw_code128_barcode(GContext *ctx, GRect bounds, const char *data)
 
 static int imin(int a, int b) { return a < b ? a : b; }
 
-static void draw_2d(GContext *ctx, GRect bounds, uint16_t w, uint16_t h,
+static void draw_2d(Canvas *cv, GRect bounds, uint16_t w, uint16_t h,
                     const uint8_t *bits, int max_bytes) {
     if (w == 0 || h == 0) return;
 
@@ -315,18 +231,11 @@ static void draw_2d(GContext *ctx, GRect bounds, uint16_t w, uint16_t h,
     int ox = bounds.origin.x + (screen_w - dx * scale) / 2;
     int oy = bounds.origin.y + (screen_h - dy * scale) / 2;
 
-    for (int r = 0; r < (int)h; r++) {
-        for (int c = 0; c < (int)w; c++) {
-            int bit_idx = r * (int)w + c;
-            if ((bit_idx >> 3) >= max_bytes) continue;   // never read past buffer
-            if (!(bits[bit_idx >> 3] & (1 << (7 - (bit_idx & 7))))) continue;
-
-            int mcx = rotate ? ((int)h - 1 - r) : c;   // grid col after rotation
-            int mcy = rotate ? c : r;                  // grid row after rotation
-            graphics_fill_rect(ctx, GRect(ox + mcx * scale, oy + mcy * scale,
-                                          scale, scale), 0, GCornerNone);
-        }
-    }
+    Layout layout = {
+        .ox = ox, .oy = oy, .mod_w = scale, .mod_h = scale,
+        .rows = h, .stretch_h = 0, .rotate = rotate
+    };
+    draw_coalesced(cv, &layout, w, h, bits, max_bytes);
 }
 
 // ============================================================================
@@ -337,7 +246,7 @@ static void draw_2d(GContext *ctx, GRect bounds, uint16_t w, uint16_t h,
 // end-to-end (zxing) before shipping.
 // ============================================================================
 
-static void draw_pdf417(GContext *ctx, GRect bounds, uint16_t w, uint16_t h,
+static void draw_pdf417(Canvas *cv, GRect bounds, uint16_t w, uint16_t h,
                         const uint8_t *bits, int max_bytes) {
     if (w == 0 || h == 0) return;
 
@@ -355,27 +264,20 @@ static void draw_pdf417(GContext *ctx, GRect bounds, uint16_t w, uint16_t h,
     int top = bounds.origin.y + pad;
     int avail_h = screen_h - 2 * pad;
 
-    for (int r = 0; r < (int)h; r++) {
-        int y0 = top + (r * avail_h) / (int)h;
-        int y1 = top + ((r + 1) * avail_h) / (int)h;
-        int rh = y1 - y0;
-        if (rh < 1) rh = 1;
-        for (int c = 0; c < (int)w; c++) {
-            int bit_idx = r * (int)w + c;
-            if ((bit_idx >> 3) >= max_bytes) continue;
-            if (!(bits[bit_idx >> 3] & (1 << (7 - (bit_idx & 7))))) continue;
-            graphics_fill_rect(ctx, GRect(ox + c * mod_w, y0, mod_w, rh), 0, GCornerNone);
-        }
-    }
+    Layout layout = {
+        .ox = ox, .oy = top, .mod_w = mod_w, .mod_h = 0,
+        .rows = h, .stretch_h = avail_h, .rotate = false
+    };
+    draw_coalesced(cv, &layout, w, h, bits, max_bytes);
 }
 
 // ============================================================================
-// 1D Code Renderer (Code 128, Code 39, EAN-13)
+// 1D Code Renderer (Code 128, Code 39, EAN/UPC, ITF)
 // Rotates 90 degrees to use full screen height for bar pattern.
 // Uses INTEGER scaling only — never fractional — to preserve bar width ratios.
 // ============================================================================
 
-static void draw_1d_rotated(GContext *ctx, GRect bounds, uint16_t w, uint16_t h,
+static void draw_1d_rotated(Canvas *cv, GRect bounds, uint16_t w, uint16_t h,
                             const uint8_t *bits) {
     int screen_w = bounds.size.w;
     int screen_h = bounds.size.h;
@@ -415,49 +317,78 @@ static void draw_1d_rotated(GContext *ctx, GRect bounds, uint16_t w, uint16_t h,
             if (run_start == -1) run_start = c;
         } else if (run_start != -1) {
             int y0 = y_offset + run_start * scale;
-            graphics_fill_rect(ctx, GRect(x_offset, y0, bar_len, (c - run_start) * scale), 0, GCornerNone);
+            canvas_fill(cv, x_offset, y0, bar_len, (c - run_start) * scale);
             run_start = -1;
         }
     }
     if (run_start != -1) {   // flush a trailing black run
         int y0 = y_offset + run_start * scale;
-        graphics_fill_rect(ctx, GRect(x_offset, y0, bar_len, ((int)w - run_start) * scale), 0, GCornerNone);
+        canvas_fill(cv, x_offset, y0, bar_len, ((int)w - run_start) * scale);
     }
 }
 
 // ============================================================================
-// QR Code Drawing (on-watch fallback for small alphanumeric QR)
+// On-watch Encoding (demo cards and cards synced as text only)
+// Turns the text into the same packed module matrix the phone sends. The app
+// does this once when a card is loaded, so every redraw is the ordinary
+// pre-rendered path and costs the same whatever the encoder did.
+// `text` must not overlap `bits`: the encoders write while still reading.
 // ============================================================================
 
-static void draw_qr_code_onwatch(GContext *ctx, GRect bounds, const char *data) {
-    uint8_t packed[200];
-    uint8_t size = 0;
+static bool is_1d(BarcodeFormat format) {
+    switch (format) {
+        case FORMAT_CODE128:
+        case FORMAT_CODE39:
+        case FORMAT_EAN13:
+        case FORMAT_EAN8:
+        case FORMAT_UPCA:
+        case FORMAT_ITF:
+            return true;
+        default:
+            return false;
+    }
+}
 
-    if (qr_generate_packed(data, packed, &size)) {
-        int avail = (bounds.size.w < bounds.size.h ? bounds.size.w : bounds.size.h) - 10;
-        int scale = avail / size;
-        if (scale < 2) scale = 2;
-        int pix_size = size * scale;
-        int ox = bounds.origin.x + (bounds.size.w - pix_size) / 2;
-        int oy = bounds.origin.y + (bounds.size.h - pix_size) / 2;
+bool barcode_encode_text(BarcodeFormat format, const char *text, uint8_t *bits, int max_len,
+                         uint16_t *width, uint16_t *height) {
+    *width = 0;
+    *height = 0;
+    if (!text || text[0] == '\0') return false;
 
-        graphics_context_set_fill_color(ctx, GColorWhite);
-        graphics_fill_rect(ctx, GRect(ox - 4, oy - 4, pix_size + 8, pix_size + 8), 0, GCornerNone);
+    if (is_1d(format)) {
+        uint16_t w = 0;
+        bool ok;
+        switch (format) {
+            case FORMAT_CODE39: ok = code39_encode(text, bits, max_len, &w); break;
+            case FORMAT_ITF:    ok = itf_encode(text, bits, max_len, &w); break;
+            case FORMAT_CODE128: ok = code128_encode(text, bits, max_len, &w); break;
+            default:            ok = ean_encode(format, text, bits, max_len, &w); break;
+        }
+        if (!ok) return false;
+        *width = w;
+        *height = 1;
+        return true;
+    }
 
-        graphics_context_set_fill_color(ctx, GColorBlack);
-        for (int r = 0; r < size; r++) {
-            for (int c = 0; c < size; c++) {
-                int idx = r * size + c;
-                if (packed[idx / 8] & (1 << (7 - (idx % 8)))) {
-                    graphics_fill_rect(ctx, GRect(ox + c * scale, oy + r * scale, scale, scale), 0, GCornerNone);
-                }
-            }
+    switch (format) {
+        case FORMAT_QR: {
+            // EC level L: the smallest version, hence the biggest modules. The
+            // encoder still raises the level when the version has room to spare.
+            uint8_t size = 0;
+            if (!qr_generate_packed(text, QR_EC_L, bits, max_len, &size)) return false;
+            *width = size;
+            *height = size;
+            return true;
         }
-    } else {
-        graphics_context_set_text_color(ctx, GColorBlack);
-        graphics_draw_text(ctx, "QR Too Large",
-            fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD), bounds,
-            GTextOverflowModeWordWrap, GTextAlignmentCenter, NULL);
+        case FORMAT_AZTEC: {
+            uint8_t size = 0;
+            if (!aztec_encode(text, bits, max_len, &size)) return false;
+            *width = size;
+            *height = size;
+            return true;
+        }
+        default:
+            return false;   // PDF417 needs the phone
     }
 }
 
@@ -465,6 +396,48 @@ static void draw_qr_code_onwatch(GContext *ctx, GRect bounds, const char *data)
 // Main Dispatcher
 // ============================================================================
 
+// Draw a pre-rendered module matrix onto a canvas (screen or offscreen bitmap).
+static void render_matrix(Canvas *cv, GRect bounds, BarcodeFormat format,
+                          uint16_t width, uint16_t height, const uint8_t *bits) {
+    if (is_1d(format)) {
+        draw_1d_rotated(cv, bounds, width, height, bits);
+        return;
+    }
+    switch (format) {
+        case FORMAT_PDF417:
+            // Wide code, non-square modules OK — fill/stretch to the screen.
+            draw_pdf417(cv, bounds, width, height, bits, MAX_BITS_LEN);
+            break;
+        case FORMAT_QR:
+        case FORMAT_AZTEC:
+        default:
+            // Square modules required to scan — uniform integer, full-screen.
+            draw_2d(cv, bounds, width, height, bits, MAX_BITS_LEN);
+            break;
+    }
+}
+
+// Render a pre-rendered matrix once into a new white 1-bit bitmap of `size`, so
+// the detail view can simply blit it on later redraws. 1-bit on every platform:
+// a barcode is black and white, and it keeps the bitmap at ~1/8 the size of an
+// 8-bit one. Returns NULL (caller draws live) for text fallbacks or no memory,
+// and for 1D codes longer than `size` is tall: drawn live at 1 px/module they
+// overhang the bounds, which a bitmap of that size would crop.
+GBitmap *barcode_render_bitmap(GSize size, BarcodeFormat format,
+                               uint16_t width, uint16_t height, const uint8_t *bits) {
+    if (width == 0 || height == 0 || !bits) return NULL;
+    if (is_1d(format) && width > size.h) return NULL;
+    GBitmap *bmp = gbitmap_create_blank(size, GBitmapFormat1Bit);
+    if (!bmp) return NULL;
+    memset(gbitmap_get_data(bmp), 0xFF, gbitmap_get_bytes_per_row(bmp) * size.h);
+
+    Canvas cv;
+    canvas_begin_bitmap(&cv, bmp);
+    render_matrix(&cv, GRect(0, 0, size.w, size.h), format, width, height, bits);
+    canvas_end(&cv);
+    return bmp;
+}
+
 void barcode_draw(GContext *ctx, GRect bounds, BarcodeFormat format,
                   uint16_t width, uint16_t height, const uint8_t *bits) {
     // Clear background
@@ -472,56 +445,33 @@ void barcode_draw(GContext *ctx, GRect bounds, BarcodeFormat format,
     graphics_fill_rect(ctx, bounds, 0, GCornerNone);
 
     if (width > 0 && height > 0 && bits) {
-        // Pre-rendered binary data from bwip-js
+        // Module matrix: from bwip-js on the phone, or barcode_encode_text
         graphics_context_set_fill_color(ctx, GColorBlack);
-        switch (format) {
-            case FORMAT_CODE128:
-            case FORMAT_CODE39:
-            case FORMAT_EAN13:
-                draw_1d_rotated(ctx, bounds, width, height, bits);
-                break;
-            case FORMAT_PDF417:
-                // Wide code, non-square modules OK — fill/stretch to the screen.
-                draw_pdf417(ctx, bounds, width, height, bits, MAX_BITS_LEN);
-                break;
-            case FORMAT_QR:
-            case FORMAT_AZTEC:
-            default:
-                // Square modules required to scan — uniform integer, full-screen.
-                draw_2d(ctx, bounds, width, height, bits, MAX_BITS_LEN);
-                break;
-        }
+        Canvas cv;
+        canvas_begin(&cv, ctx);
+        render_matrix(&cv, bounds, format, width, height, bits);
+        canvas_end(&cv);
         return;
     }
 
-    // Fallback: no pre-rendered data. Bits buffer contains raw text.
-    // This handles demo cards and edge cases.
+    // No matrix: either no data at all, or text that barcode_encode_text
+    // couldn't turn into a code (bits then hold that text). Say which.
     const char *text_data = (const char *)bits;
+    const char *msg;
     if (!text_data || text_data[0] == '\0') {
-        graphics_context_set_text_color(ctx, GColorBlack);
-        graphics_draw_text(ctx, "No Data\nSync from phone",
-            fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD), bounds,
-            GTextOverflowModeWordWrap, GTextAlignmentCenter, NULL);
-        return;
-    }
-
-    switch (format) {
-        case FORMAT_CODE128:
-        case FORMAT_CODE39:
-        case FORMAT_EAN13:
-            draw_code128_barcode(ctx, bounds, text_data);
-            break;
-
-        case FORMAT_QR:
-            draw_qr_code_onwatch(ctx, bounds, text_data);
-            break;
-
-        default:
-            // Aztec/PDF417 without pre-rendering - can't render on watch
-            graphics_context_set_text_color(ctx, GColorBlack);
-            graphics_draw_text(ctx, "Resync from phone",
-                fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD), bounds,
-                GTextOverflowModeWordWrap, GTextAlignmentCenter, NULL);
-            break;
+        msg = "No Data\nSync from phone";
+    } else if (format == FORMAT_QR) {
+        msg = "QR Too Large";
+    } else if (format == FORMAT_CODE128) {
+        msg = "Code Too Long";
+    } else if (is_1d(format)) {
+        msg = "Invalid Code";   // wrong length/characters or a bad check digit
+    } else if (format == FORMAT_AZTEC) {
+        msg = "Aztec Too Large";
+    } else {
+        msg = "Resync from phone";   // PDF417 can't be encoded on the watch
     }
+    graphics_context_set_text_color(ctx, GColorBlack);
+    graphics_draw_text(ctx, msg, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD), bounds,
+        GTextOverflowModeWordWrap, GTextAlignmentCenter, NULL);
 }
@@ -0,0 +1,207 @@
+#include "common.h"
+#include <string.h>
+
+// ============================================================================
+// Code 128 Encoder - on-watch fallback for cards that only have text
+// Finds the shortest symbol by dynamic programming over code sets A/B/C with
+// SHIFT and latch codes, supports FNC1 (GS1-128) and FNC4 (Latin-1), and emits
+// the symbol as a 1-row packed module bitmap in the same MSB-first layout the
+// phone sends, so it renders through the regular 1D path. Fewer symbols means
+// fewer modules, which means a larger integer module scale on screen.
+// ============================================================================
+
+// Symbol patterns as 11-bit words, first module in bit 10, 1 = bar. 212 bytes
+// of ROM instead of the 636-byte bar/space width table.
+static const uint16_t CODE128_WORDS[106] = {
+    0x6CC, 0x66C, 0x666, 0x498, 0x48C, 0x44C, 0x4C8, 0x4C4,
+    0x464, 0x648, 0x644, 0x624, 0x59C, 0x4DC, 0x4CE, 0x5CC,
+    0x4EC, 0x4E6, 0x672, 0x65C, 0x64E, 0x6E4, 0x674, 0x76E,
+    0x74C, 0x72C, 0x726, 0x764, 0x734, 0x732, 0x6D8, 0x6C6,
+    0x636, 0x518, 0x458, 0x446, 0x588, 0x468, 0x462, 0x688,
+    0x628, 0x622, 0x5B8, 0x58E, 0x46E, 0x5D8, 0x5C6, 0x476,
+    0x776, 0x68E, 0x62E, 0x6E8, 0x6E2, 0x6EE, 0x758, 0x746,
+    0x716, 0x768, 0x762, 0x71A, 0x77A, 0x642, 0x78A, 0x530,
+    0x50C, 0x4B0, 0x486, 0x42C, 0x426, 0x590, 0x584, 0x4D0,
+    0x4C2, 0x434, 0x432, 0x612, 0x650, 0x7BA, 0x614, 0x47A,
+    0x53C, 0x4BC, 0x49E, 0x5E4, 0x4F4, 0x4F2, 0x7A4, 0x794,
+    0x792, 0x6DE, 0x6F6, 0x7B6, 0x578, 0x51E, 0x45E, 0x5E8,
+    0x5E2, 0x7A8, 0x7A2, 0x5DE, 0x5EE, 0x75E, 0x7AE, 0x684,
+    0x690, 0x69C,
+};
+
+#define STOP_WORD   0x18EB   // 2331112, the only 13-module pattern
+#define STOP_BITS   13
+
+#define SYM_SHIFT   98
+#define SYM_CODE_A  101      // latch to set t is SYM_CODE_A - t (C=99, B=100)
+#define SYM_FNC1    102
+#define SYM_START_A 103      // start in set t is SYM_START_A + t
+
+enum { SET_A = 0, SET_B = 1, SET_C = 2, NUM_SETS = 3 };
+
+// DP step chosen at (position, set): which set to be in before encoding the
+// next input (a latch if it differs), and whether that char goes via SHIFT.
+#define CHOICE_SET(c)   ((c) & 3)
+#define CHOICE_SHIFT    0x04
+#define COST_INF        0x7FFF
+
+// Latch preference on ties: B covers the most text, then C, then A.
+static const uint8_t LATCH_ORDER[NUM_SETS] = { SET_B, SET_C, SET_A };
+
+// Input view. GS1 data is marked with a leading "]C1" (the AIM symbology
+// identifier); inside it, ASCII GS (0x1D) separates fields and becomes FNC1.
+typedef struct {
+    const uint8_t *s;
+    int n;
+    bool gs1;
+} Input;
+
+static bool is_fnc1(const Input *in, int i) { return in->gs1 && in->s[i] == 0x1D; }
+static bool is_digit(uint8_t c) { return c >= '0' && c <= '9'; }
+
+// Can the low 7 bits of c be encoded in set A (0x00-0x5F) or B (0x20-0x7F)?
+static bool in_set(uint8_t c, int set) {
+    c &= 0x7F;
+    return set == SET_A ? c < 96 : c >= 32;
+}
+
+static int char_value(uint8_t c, int set) {
+    c &= 0x7F;
+    return (set == SET_A && c < 32) ? c + 64 : c - 32;
+}
+
+// Symbols to encode the input at i in `set` without latching, or COST_INF.
+// `rest1`/`rest2` are the best costs from i+1 and i+2 staying in `set`.
+static int step_cost(const Input *in, int i, int set, int rest1, int rest2, bool *shift) {
+    *shift = false;
+    if (is_fnc1(in, i)) return 1 + rest1;
+    if (set == SET_C) {
+        if (i + 1 < in->n && is_digit(in->s[i]) && is_digit(in->s[i + 1]) && !is_fnc1(in, i + 1)) {
+            return 1 + rest2;
+        }
+        return COST_INF;
+    }
+    uint8_t c = in->s[i];
+    int ext = (c & 0x80) ? 1 : 0;              // FNC4 prefix for 0x80-0xFF
+    if (in_set(c, set)) return 1 + ext + rest1;
+    if (!ext && in_set(c, 1 - set)) {          // one char from the other set
+        *shift = true;
+        return 2 + rest1;
+    }
+    return COST_INF;
+}
+
+// Bit writer for the packed row; also accumulates the mod-103 checksum.
+typedef struct {
+    uint8_t *out;
+    int bit;
+    uint32_t sum;
+    int weight;
+} Emitter;
+
+static void put_bits(Emitter *e, uint16_t word, int nbits) {
+    for (int k = nbits - 1; k >= 0; k--, e->bit++) {
+        if (word & (1 << k)) e->out[e->bit >> 3] |= (uint8_t)(0x80 >> (e->bit & 7));
+    }
+}
+
+// Data symbols are weighted by position (1, 2, ...); the start code by 1.
+static void put_symbol(Emitter *e, int value) {
+    put_bits(e, CODE128_WORDS[value], 11);
+    e->sum += (uint32_t)value * (uint32_t)e->weight;
+    e->weight++;
+}
+
+bool code128_encode(const char *text, uint8_t *out, int out_len, uint16_t *out_width) {
+    if (!text || !out || !out_width) return false;
+    Input in = { (const uint8_t *)text, (int)strlen(text), false };
+    if (in.n >= 3 && memcmp(text, "]C1", 3) == 0) {
+        in.s += 3;
+        in.n -= 3;
+        in.gs1 = true;
+    }
+    if (in.n == 0 || in.n > MAX_TEXT_LEN) return false;
+
+    // Backward pass: cost[s] = fewest symbols encoding input[i..] from set s.
+    // Latching twice in a row never helps, so each position allows one latch.
+    // Only the choices are kept (3 bytes per char); costs roll over 3 rows.
+    uint8_t *choice = malloc(in.n * NUM_SETS);
+    if (!choice) return false;
+    int next1[NUM_SETS] = {0, 0, 0};           // costs at i+1
+    int next2[NUM_SETS] = {0, 0, 0};           // costs at i+2
+    int cur[NUM_SETS];
+    for (int i = in.n - 1; i >= 0; i--) {
+        int base[NUM_SETS];
+        bool shift[NUM_SETS];
+        for (int s = 0; s < NUM_SETS; s++) {
+            base[s] = step_cost(&in, i, s, next1[s], next2[s], &shift[s]);
+            if (base[s] > COST_INF) base[s] = COST_INF;
+        }
+        for (int s = 0; s < NUM_SETS; s++) {
+            int best = base[s], via = s;
+            for (int k = 0; k < NUM_SETS; k++) {
+                int t = LATCH_ORDER[k];
+                if (t != s && base[t] < COST_INF && 1 + base[t] < best) {
+                    best = 1 + base[t];
+                    via = t;
+                }
+            }
+            cur[s] = best;
+            choice[i * NUM_SETS + s] = (uint8_t)(via | (shift[via] ? CHOICE_SHIFT : 0));
+        }
+        memcpy(next2, next1, sizeof(next1));
+        memcpy(next1, cur, sizeof(cur));
+    }
+
+    int set = SET_B;
+    if (next1[SET_C] < next1[set]) set = SET_C;
+    if (next1[SET_A] < next1[set]) set = SET_A;
+    if (next1[set] >= COST_INF) {
+        free(choice);
+        return false;
+    }
+
+    // start + [FNC1] + data + check, 11 modules each, then the stop pattern.
+    int symbols = 1 + (in.gs1 ? 1 : 0) + next1[set] + 1;
+    int width = symbols * 11 + STOP_BITS;
+    if ((width + 7) / 8 > out_len) {
+        free(choice);
+        return false;
+    }
+    memset(out, 0, (width + 7) / 8);
+
+    // Forward pass: replay the choices.
+    Emitter e = { out, 0, 0, 1 };
+    put_symbol(&e, SYM_START_A + set);
+    e.weight = 1;
+    if (in.gs1) put_symbol(&e, SYM_FNC1);
+    for (int i = 0; i < in.n;) {
+        uint8_t ch = choice[i * NUM_SETS + set];
+        if (CHOICE_SET(ch) != set) {
+            set = CHOICE_SET(ch);
+            put_symbol(&e, SYM_CODE_A - set);
+        }
+        uint8_t c = in.s[i];
+        if (is_fnc1(&in, i)) {
+            put_symbol(&e, SYM_FNC1);
+            i++;
+        } else if (set == SET_C) {
+            put_symbol(&e, (c - '0') * 10 + (in.s[i + 1] - '0'));
+            i += 2;
+        } else if (ch & CHOICE_SHIFT) {
+            put_symbol(&e, SYM_SHIFT);
+            put_symbol(&e, char_value(c, 1 - set));
+            i++;
+        } else {
+            if (c & 0x80) put_symbol(&e, SYM_CODE_A - set);   // FNC4 in A/B
+            put_symbol(&e, char_value(c, set));
+            i++;
+        }
+    }
+    free(choice);
+
+    put_bits(&e, CODE128_WORDS[e.sum % 103], 11);
+    put_bits(&e, STOP_WORD, STOP_BITS);
+    *out_width = (uint16_t)width;
+    return true;
+}
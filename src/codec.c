@@ -0,0 +1,95 @@
+#include "common.h"
+#include <string.h>
+
+// ============================================================================
+// Matrix Codec - decoder for the packed matrices the phone may send
+// MATRIX_CODEC_ROW_RICE: each module is XORed with the one directly above it
+// (row 0 against white), so columns that repeat down the symbol -- PDF417
+// start/stop patterns, QR finder edges, quiet stripes -- become zeros. The
+// zero runs between the remaining ones are Rice-coded:
+//   byte 0      Rice parameter k (0..7)
+//   then, MSB first, per run: q = run >> k as q one-bits and a zero-bit,
+//   followed by the low k bits of run. Each run ends in a one module, except
+//   a final run that reaches the end of the matrix.
+// At k = 0 and 50% density this costs one bit per module, so the phone falls
+// back to MATRIX_CODEC_RAW whenever packing wouldn't save anything.
+// The encoder lives in pebble-js-app.js (packMatrix).
+// ============================================================================
+
+typedef struct {
+    const uint8_t *data;
+    int len;
+    int pos;   // bits consumed
+} BitReader;
+
+static int read_bit(BitReader *r) {
+    if ((r->pos >> 3) >= r->len) return -1;
+    int bit = (r->data[r->pos >> 3] >> (7 - (r->pos & 7))) & 1;
+    r->pos++;
+    return bit;
+}
+
+// One run length, or -1 if the stream ends first.
+static int read_run(BitReader *r, int k) {
+    int q = 0, bit;
+    while ((bit = read_bit(r)) == 1) q++;
+    if (bit < 0) return -1;
+    int run = q << k;
+    for (int i = k - 1; i >= 0; i--) {
+        if ((bit = read_bit(r)) < 0) return -1;
+        run |= bit << i;
+    }
+    return run;
+}
+
+static inline int get_module(const uint8_t *bits, int i) {
+    return (bits[i >> 3] >> (7 - (i & 7))) & 1;
+}
+
+static inline void set_module(uint8_t *bits, int i) {
+    bits[i >> 3] |= (uint8_t)(0x80 >> (i & 7));
+}
+
+static bool decode_row_rice(const uint8_t *packed, int packed_len, int width, int total,
+                            uint8_t *out) {
+    if (packed_len < 1 || packed[0] > 7) return false;
+    BitReader r = { packed, packed_len, 8 };
+    int k = packed[0];
+    int pos = 0;
+    while (pos < total) {
+        int run = read_run(&r, k);
+        if (run < 0 || run > total - pos) return false;
+        // Zero delta: the module repeats the one above it.
+        for (int end = pos + run; pos < end; pos++) {
+            if (pos >= width && get_module(out, pos - width)) set_module(out, pos);
+        }
+        if (pos == total) break;
+        // One delta: the module flips relative to the one above it.
+        if (pos < width || !get_module(out, pos - width)) set_module(out, pos);
+        pos++;
+    }
+    return true;
+}
+
+// Unpack a stored matrix into `out` (cleared first). False if the codec is
+// unknown or the data is truncated/corrupt, so the caller can show an error
+// instead of a misleading partial code.
+bool matrix_decode(uint8_t codec, const uint8_t *packed, int packed_len,
+                   uint16_t width, uint16_t height, uint8_t *out, int out_len) {
+    int total = (int)width * height;
+    int bytes = (total + 7) / 8;
+    if (!packed || !out || total <= 0 || bytes > out_len) return false;
+    memset(out, 0, out_len);
+
+    switch (codec) {
+        case MATRIX_CODEC_RAW:
+            if (packed_len < bytes) return false;
+            memcpy(out, packed, bytes);
+            return true;
+        case MATRIX_CODEC_ROW_RICE:
+            return decode_row_rice(packed, packed_len, width, total, out);
+        default:
+            APP_LOG(APP_LOG_LEVEL_ERROR, "Unknown matrix codec %d", codec);
+            return false;
+    }
+}
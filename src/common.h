@@ -2,26 +2,36 @@
 #include <pebble.h>
 
 // --- Constants ---
-#define MAX_CARDS 10
+// Cards are paged in from storage on demand (storage_card_info), so the count
+// is bounded by the ~4KB persist budget, not RAM: ~50 bytes per text-only card.
+#define MAX_CARDS 128
 #define MAX_NAME_LEN 32
 #define MAX_DATA_LEN 1024
 // 1400 bytes of raw bits = 11200 pixels (~105x106 2D, e.g. a full boarding-pass
-// PDF417). Matrices this large are streamed from the phone in 80-byte chunks
-// (see main.c chunked-sync protocol) so they are no longer capped by the
-// AppMessage inbox size. Note: Pebble persistent storage is ~4KB total per app,
-// so only a few cards this large can be stored at once (see storage.c).
+// PDF417). Matrices this large are streamed from the phone in inbox-sized
+// chunks (KEY_CHUNK_MAX), packed into binary KEY_FRAMES records (see rx_frames
+// in main.c), so they are not capped by a single AppMessage. Note: Pebble
+// persistent storage is ~4KB total per app, so only a few cards this large can
+// be stored at once (see storage.c).
 #define MAX_BITS_LEN 1400
 // Human-readable card text (the loyalty number / boarding-pass string) is stored
 // alongside the matrix so the detail view can toggle to show it. Capped at 255 so
 // it fits a single persist value (per-key max 256) AND a single AppMessage header.
 #define MAX_TEXT_LEN 255
-#define PERSIST_KEY_COUNT 500
+#define PERSIST_KEY_DIR 500    // card directory (storage.c); held the bare count before v6
 #define PERSIST_KEY_SCHEMA 501
 #define PERSIST_KEY_LAST 502   // index of the last-viewed card (launch straight to it)
+#define PERSIST_KEY_DIR_TABLE 510   // + k: directory record table (storage.c), 2 banks x 2 keys
 // Bump when the persistent card layout changes so upgrades wipe cleanly.
 // v3 = chunked-sync layout (KEYS_PER_CARD 15, MAX_BITS_LEN 1400) introduced 2.3.0.
 // v4 = per-card raw text (KEYS_PER_CARD 16, WalletCardInfo.text_len) introduced 2.4.0.
-#define STORAGE_SCHEMA_VERSION 4
+// v5 = per-card matrix codec (WalletCardInfo.codec, KEY_CODEC).
+// v6 = packed page store: card records in 256-byte pages plus a directory.
+// v7 = per-card content hash for delta sync (WalletCardInfo.hash).
+// v8 = live-page bitmap in the directory (no persist_exists probing).
+// v9 = compact variable-length card records, directory table split over keys.
+// v10 = record CRC + generation, two-bank directory table with a CRC'd header.
+#define STORAGE_SCHEMA_VERSION 10
 #define PERSIST_KEY_BASE 24200
 
 // --- Types ---
@@ -31,39 +41,114 @@ typedef enum {
     FORMAT_EAN13 = 2,
     FORMAT_QR = 3,
     FORMAT_AZTEC = 4,
-    FORMAT_PDF417 = 5
+    FORMAT_PDF417 = 5,
+    FORMAT_EAN8 = 6,
+    FORMAT_UPCA = 7,
+    FORMAT_ITF = 8
 } BarcodeFormat;
 
-// Lightweight card info (kept in RAM for all cards)
+// How a card's matrix is stored and synced (see codec.c).
+typedef enum {
+    MATRIX_CODEC_RAW = 0,        // continuous MSB-first bits, as the config page emits
+    MATRIX_CODEC_ROW_RICE = 1    // XOR with the row above, Rice-coded zero runs
+} MatrixCodec;
+
+// One card's info, as storage_card_info() pages it in from the record header
 typedef struct {
     BarcodeFormat format;
     char name[MAX_NAME_LEN];
     char description[MAX_NAME_LEN];
     uint16_t width;    // Pre-rendered barcode width in pixels
     uint16_t height;   // Pre-rendered barcode height in pixels
-    uint16_t data_len; // Length of stored binary data in bytes
+    uint16_t data_len; // Length of stored binary data in bytes (as packed)
     uint16_t text_len; // Length of stored human-readable text in bytes
+    uint8_t codec;     // MatrixCodec of the stored data
+    uint32_t hash;     // phone-computed content hash (delta sync), 0 = unknown
 } WalletCardInfo;
 
+// Persist budget (storage_get_usage). A card set fits when the sum of its
+// records (record_header + name + description + matrix + text bytes) is at most
+// heap_max, and that sum plus per_card per card is at most capacity.
+typedef struct {
+    uint16_t budget;          // persist bytes the app may use, key overhead included
+    uint16_t used;            // charged now (dead records until compaction included)
+    uint16_t free;
+    uint16_t capacity;        // for records + per_card per card
+    uint16_t heap_max;        // for records alone: the page heap
+    uint8_t per_card;
+    uint8_t record_header;
+} StorageUsage;
+
+// Persist writes since storage_reset_io_stats (sync telemetry).
+typedef struct {
+    uint32_t writes;
+    uint32_t deletes;
+    uint32_t bytes;           // written
+    uint32_t write_ms;        // total time spent in persist_write_data
+    uint32_t write_ms_max;    // slowest single write
+} StorageIoStats;
+
 // --- Global State ---
-extern WalletCardInfo g_cards[MAX_CARDS];
 extern int g_card_count;
 extern uint8_t g_active_bits[MAX_BITS_LEN]; // On-demand loaded barcode data
 
 // --- Storage ---
 void storage_load_cards(void);
-bool storage_save_card(int index, WalletCardInfo *info, const uint8_t *bits,
+const WalletCardInfo *storage_card_info(int index);
+bool storage_verify_card(int index);
+bool storage_save_card(int index, const WalletCardInfo *info, const uint8_t *bits,
                        int bits_len, const char *text, int text_len);
+bool storage_card_stream_begin(int index, const WalletCardInfo *info, int data_len,
+                               const char *text, int text_len);
+bool storage_card_stream_write(int offset, const uint8_t *data, int len);
+int storage_card_stream_received(void);
+void storage_card_stream_move(int index);
+bool storage_card_stream_commit(void);
+void storage_card_stream_abort(void);
 void storage_save_count(int count);
-void storage_load_card_data(int index, uint8_t *buffer, int max_len);
+int storage_apply_manifest(const uint8_t *manifest, int count, uint8_t *need, int need_max);
+bool storage_has_missing_cards(void);
+bool storage_load_card_data(int index, uint8_t *buffer, int max_len);
 void storage_load_card_text(int index, char *buffer, int max_len);
 void storage_wipe_all_cards(void);
+void storage_get_usage(StorageUsage *out);
+void storage_get_io_stats(StorageIoStats *out);
+void storage_reset_io_stats(void);
 void storage_save_last_index(int index);
 int storage_load_last_index(void);
 
-// --- QR Generator (on-watch fallback for small alphanumeric QR) ---
-bool qr_generate_packed(const char *data, uint8_t *output_buffer, uint8_t *out_size);
+// --- Matrix Codec (codec.c: unpacks matrices the phone sent packed) ---
+bool matrix_decode(uint8_t codec, const uint8_t *packed, int packed_len,
+                   uint16_t width, uint16_t height, uint8_t *out, int out_len);
+
+// --- QR Generator (on-watch encoding for QR cards synced as text) ---
+typedef enum {
+    QR_EC_L = 0,   // ~7% recovery
+    QR_EC_M,       // ~15%
+    QR_EC_Q,       // ~25%
+    QR_EC_H,       // ~30%
+} QrEcLevel;
+
+#define QR_PACKED_MAX ((57 * 57 + 7) / 8)   // version 10, the largest generated
+bool qr_generate_packed(const char *data, QrEcLevel min_ec, uint8_t *output_buffer,
+                        int out_len, uint8_t *out_size);
+
+// --- Code 128 Encoder (on-watch encoding for 1D cards synced as text) ---
+bool code128_encode(const char *text, uint8_t *out, int out_len, uint16_t *out_width);
+
+// --- 1D Encoders (linear.c: on-watch encoding for 1D cards synced as text) ---
+bool ean_encode(BarcodeFormat format, const char *text, uint8_t *out, int out_len,
+                uint16_t *out_width);   // FORMAT_EAN13 / FORMAT_EAN8 / FORMAT_UPCA
+bool code39_encode(const char *text, uint8_t *out, int out_len, uint16_t *out_width);
+bool itf_encode(const char *text, uint8_t *out, int out_len, uint16_t *out_width);
+
+// --- Aztec Encoder (on-watch encoding for Aztec cards synced as text) ---
+bool aztec_encode(const char *text, uint8_t *out, int out_len, uint8_t *out_size);
 
 // --- Barcode Renderer ---
 void barcode_draw(GContext *ctx, GRect bounds, BarcodeFormat format,
                   uint16_t width, uint16_t height, const uint8_t *bits);
+bool barcode_encode_text(BarcodeFormat format, const char *text, uint8_t *bits, int max_len,
+                         uint16_t *width, uint16_t *height);
+GBitmap *barcode_render_bitmap(GSize size, BarcodeFormat format,
+                               uint16_t width, uint16_t height, const uint8_t *bits);
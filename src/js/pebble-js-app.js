@@ -1,7 +1,8 @@
 /**
  * Pebble Wallet - Phone-side JavaScript
  * Handles configuration page and binary card sync.
- * All barcode encoding is done by bwip-js in the config page.
+ * Barcodes are encoded by bwip-js in the config page, except formats the watch
+ * encodes itself (WATCH_ENCODED_FORMATS), which are synced as text only.
  * Cards arrive as {name, description, data: "w,h,hex", text: "original", format}.
  */
 
@@ -23,150 +24,546 @@ function saveCards(cards) {
 }
 
 // --- Bitmap Optimization ---
+// Matrices are continuous MSB-first bit streams (matching the config page
+// output and the C reader), handled as Uint8Arrays and read 32 bits at a time.
 
-// Remove whitespace borders from pre-rendered barcode bitmap.
-// Uses continuous bit packing (matching config page output and C reader).
-function cropBitmap(width, height, hex) {
-    var totalBits = width * height;
-    var totalBytes = Math.ceil(totalBits / 8);
+var HEX_NIBBLE = (function() {
+    var t = new Uint8Array(128);
+    for (var i = 0; i < 10; i++) t[48 + i] = i;
+    for (var j = 0; j < 6; j++) t[65 + j] = t[97 + j] = 10 + j;
+    return t;
+})();
 
-    // Parse hex to bytes
-    var bytes = [];
-    for (var i = 0; i < hex.length; i += 2) {
-        bytes.push(parseInt(hex.substr(i, 2), 16));
+function hexToBytes(hex) {
+    var out = new Uint8Array(hex.length >> 1);
+    for (var i = 0; i < out.length; i++) {
+        out[i] = (HEX_NIBBLE[hex.charCodeAt(2 * i) & 0x7F] << 4) |
+            HEX_NIBBLE[hex.charCodeAt(2 * i + 1) & 0x7F];
     }
-    if (bytes.length < totalBytes) {
-        return { width: width, height: height, hex: hex };
+    return out;
+}
+
+function bytesToHex(bytes) {
+    var s = '';
+    for (var i = 0; i < bytes.length; i++) s += (bytes[i] < 16 ? '0' : '') + bytes[i].toString(16);
+    return s;
+}
+
+// The 32 bits starting at bit `bit` (MSB first); bits past the end read as 0.
+function bitsAt(bytes, bit) {
+    var i = bit >> 3, s = bit & 7;
+    var w = ((bytes[i] << 24) | (bytes[i + 1] << 16) | (bytes[i + 2] << 8) | bytes[i + 3]) >>> 0;
+    return s ? ((w << s) | (bytes[i + 4] >>> (8 - s))) >>> 0 : w;
+}
+
+// OR the top `n` bits of `w` into `out` at bit `bit`.
+function putBits(out, bit, w, n) {
+    while (n > 0) {
+        var s = bit & 7, take = 8 - s < n ? 8 - s : n;
+        out[bit >> 3] |= (w >>> (32 - take)) << (8 - s - take);
+        w = (w << take) >>> 0;
+        bit += take;
+        n -= take;
     }
+}
+
+var clz32 = Math.clz32 || function(v) {
+    var n = 0;
+    if (v === 0) return 32;
+    while (!(v & 0x80000000)) { v <<= 1; n++; }
+    return n;
+};
 
-    // Scan for bounding box of black pixels using continuous indexing
-    var minX = width, maxX = 0, minY = height, maxY = 0;
-    var found = false;
+// Remove whitespace borders from a pre-rendered barcode bitmap. Each row is
+// scanned a word at a time: the rows with any black give the vertical bounds,
+// and the OR of all rows' words gives the horizontal ones. The kept region is
+// then copied row by row, shifted a word at a time.
+function cropBitmap(width, height, bytes) {
+    if (bytes.length < (width * height + 7) >> 3) {
+        return { width: width, height: height, bytes: bytes };
+    }
+    var words = (width + 31) >> 5;
+    var tailMask = width & 31 ? (0xFFFFFFFF << (32 - (width & 31))) >>> 0 : 0xFFFFFFFF;
+    var cols = new Uint32Array(words);
+    var minY = -1, maxY = -1;
     for (var y = 0; y < height; y++) {
-        for (var x = 0; x < width; x++) {
-            var bitIdx = y * width + x;
-            var byteIdx = Math.floor(bitIdx / 8);
-            var bitPos = 7 - (bitIdx % 8);
-            if ((bytes[byteIdx] >> bitPos) & 1) {
-                if (x < minX) minX = x;
-                if (x > maxX) maxX = x;
-                if (y < minY) minY = y;
-                if (y > maxY) maxY = y;
-                found = true;
-            }
+        var any = 0;
+        for (var k = 0; k < words; k++) {
+            var w = bitsAt(bytes, y * width + 32 * k);
+            if (k === words - 1) w = (w & tailMask) >>> 0;
+            cols[k] |= w;
+            any |= w;
         }
-    }
-
-    if (!found) {
-        return { width: width, height: height, hex: hex };
-    }
-
-    var newW = maxX - minX + 1;
-    var newH = maxY - minY + 1;
-    var newTotalBits = newW * newH;
-    var newTotalBytes = Math.ceil(newTotalBits / 8);
-    var newBytes = [];
-    for (var k = 0; k < newTotalBytes; k++) newBytes.push(0);
-
-    // Copy cropped region using continuous bit packing
-    for (var y = 0; y < newH; y++) {
-        for (var x = 0; x < newW; x++) {
-            var srcBitIdx = (y + minY) * width + (x + minX);
-            var srcByteIdx = Math.floor(srcBitIdx / 8);
-            var srcBitPos = 7 - (srcBitIdx % 8);
-            if ((bytes[srcByteIdx] >> srcBitPos) & 1) {
-                var dstBitIdx = y * newW + x;
-                var dstByteIdx = Math.floor(dstBitIdx / 8);
-                var dstBitPos = 7 - (dstBitIdx % 8);
-                newBytes[dstByteIdx] |= (1 << dstBitPos);
-            }
+        if (any) {
+            if (minY < 0) minY = y;
+            maxY = y;
         }
     }
+    if (minY < 0) return { width: width, height: height, bytes: bytes };
 
-    var newHex = '';
-    for (var i = 0; i < newBytes.length; i++) {
-        var h = newBytes[i].toString(16);
-        if (h.length < 2) h = '0' + h;
-        newHex += h;
+    for (var a = 0; !cols[a]; a++) {}
+    for (var b = words - 1; !cols[b]; b--) {}
+    var minX = 32 * a + clz32(cols[a]);
+    var maxX = 32 * b + clz32(cols[b] & -cols[b]);   // lowest set bit
+    if (minX === 0 && maxX === width - 1 && minY === 0 && maxY === height - 1) {
+        return { width: width, height: height, bytes: bytes };
     }
 
-    return { width: newW, height: newH, hex: newHex };
+    var newW = maxX - minX + 1, newH = maxY - minY + 1;
+    var out = new Uint8Array((newW * newH + 7) >> 3);
+    for (var r = 0; r < newH; r++) {
+        var src = (r + minY) * width + minX, dst = r * newW;
+        for (var x = 0; x < newW; x += 32) {
+            putBits(out, dst + x, bitsAt(bytes, src + x), newW - x < 32 ? newW - x : 32);
+        }
+    }
+    return { width: newW, height: newH, bytes: out };
 }
 
 // --- Sync Protocol ---
 //
-// Large barcodes (e.g. PDF417 boarding passes) no longer have to fit in one
-// AppMessage. Each card is streamed as:
-//   1. a header  { KEY_INDEX, KEY_NAME, KEY_DESCRIPTION, KEY_FORMAT,
-//                  KEY_WIDTH, KEY_HEIGHT, KEY_DATA_LEN }
-//   2. N chunks  { KEY_INDEX, KEY_DATA_OFFSET, KEY_DATA(<=80 bytes) }
-// The watch reassembles the chunks by offset (see main.c).
-
-var CHUNK_SIZE = 80;            // bytes of pixel data per AppMessage
+// Cards travel as binary records packed into one KEY_FRAMES byte array per
+// AppMessage (protocol v2, parsed by rx_frames in main.c):
+//   SYNC_FRAME_VERSION, then records: type u8 | len u16 | payload
+//   FRAME_CARD  index, format, codec, name/desc/text lengths (u8 each),
+//               width, height, data_len (u16), hash (4 bytes), name, desc, text
+//   FRAME_DATA  index u8, offset u16, matrix bytes
+// A card is one FRAME_CARD then FRAME_DATA records, split across messages
+// only where a message is full, so several small cards share one message and
+// the last one also carries CMD_SYNC_COMPLETE. The matrix goes as packed by
+// its codec; the watch stores it that way. A message holds up to what the
+// watch's inbox takes (KEY_CHUNK_MAX, reported with KEY_BUDGET), and messages
+// go out as fast as the watch ACKs them.
+
+var SYNC_FRAME_VERSION = 2;     // must match SYNC_FRAME_VERSION in main.c
+var FRAME_CARD = 1;
+var FRAME_DATA = 2;
+var FRAME_RECORD_HEADER = 3;    // type + u16 length
+var FRAME_DATA_FIXED = 3;       // index + u16 offset
+var MIN_DATA_RECORD = 16;       // less room than this left: start a new message
+var DEFAULT_CHUNK_SIZE = 80;    // until the watch reports KEY_CHUNK_MAX
 var MAX_CARD_BYTES = 1400;      // must match MAX_BITS_LEN in common.h
-var STORAGE_BUDGET = 3900;      // Pebble persist is ~4KB/app; keep a safety margin
-var PER_CARD_OVERHEAD = 80;     // approx bytes the WalletCardInfo struct persists
+var MAX_CARDS = 128;            // must match MAX_CARDS in common.h
+var MAX_FIELD_BYTES = 31;       // name/description are stored up to MAX_NAME_LEN - 1 bytes
+
+// What a card set may use in the watch's persist storage. The watch reports it
+// (KEY_BUDGET, from storage_get_usage) with every card request and delta
+// reply; these defaults match the current watch build until it has.
+var DEFAULT_BUDGET = { capacity: 3808, heapMax: 3840, perCard: 8, recordHeader: 24 };
+
+function loadBudget() {
+    try {
+        var b = JSON.parse(localStorage.getItem('pebble_wallet_budget'));
+        if (b && b.capacity > 0) return b;
+    } catch (e) {}
+    return DEFAULT_BUDGET;
+}
+
+function loadChunkSize() {
+    var n = parseInt(localStorage.getItem('pebble_wallet_chunk'), 10);
+    return n > 0 ? n : DEFAULT_CHUNK_SIZE;
+}
+
+function saveChunkSize(n) {
+    if (n > 0 && n !== loadChunkSize()) {
+        localStorage.setItem('pebble_wallet_chunk', String(n));
+        console.log('Watch chunk size: ' + n + ' bytes');
+    }
+}
+
+// Cache a KEY_BUDGET report; true if it differs from what was planned against.
+function saveBudget(bytes) {
+    if (!bytes || bytes.length < 8) return false;
+    var u16 = function(i) { return bytes[2 * i] | (bytes[2 * i + 1] << 8); };
+    var b = { capacity: u16(0), heapMax: u16(1), perCard: u16(2), recordHeader: u16(3) };
+    var json = JSON.stringify(b);
+    if (json === JSON.stringify(loadBudget())) return false;
+    localStorage.setItem('pebble_wallet_budget', json);
+    console.log('Watch storage budget: ' + json);
+    return true;
+}
+
+// UTF-8 bytes the watch stores for a name/description field.
+function fieldCost(s) {
+    var n = unescape(encodeURIComponent(s || '')).length;
+    return n < MAX_FIELD_BYTES ? n : MAX_FIELD_BYTES;
+}
+
+// Formats the watch can encode from the card text (barcode_encode_text in
+// barcodes.c). Those cards are synced as text only, a fraction of the matrix's
+// persist cost. The watch encodes the UTF-8 bytes, so only ASCII text qualifies
+// (bwip-js would encode anything else differently). 1D formats also need text
+// the watch's encoder accepts (linear.c), else the card keeps its matrix: a
+// text-only card has nothing to fall back on if the watch refuses it.
+var WATCH_ENCODED_FORMATS = {
+    1: /^[0-9A-Z .$\/+%-]+$/,    // Code 39
+    2: /^\d{12,13}$/,            // EAN-13
+    3: /^[\x01-\x7f]+$/,         // QR: byte mode, v10-L holds 271 > MAX_TEXT_LEN
+    4: /^[\x01-\x7f]+$/,         // Aztec
+    6: /^\d{7,8}$/,              // EAN-8
+    7: /^\d{11,12}$/,            // UPC-A
+    8: /^\d{1,18}$/              // ITF: 20+ digits overhang a 146 px code area
+};
+
+// Full lengths whose last digit is a GS1 check digit (EAN-13, EAN-8, UPC-A):
+// the watch verifies it and refuses a wrong one ("Invalid Code").
+var GS1_CHECKED_LENGTH = { 2: 13, 6: 8, 7: 12 };
+
+// GS1 mod-10 check digit of a digit string: weights 3, 1, 3... from the right
+// (gs1_check_digit in linear.c).
+function gs1CheckDigit(digits) {
+    var sum = 0;
+    for (var i = 0; i < digits.length; i++) {
+        sum += (digits.charCodeAt(digits.length - 1 - i) - 48) * ((i & 1) ? 1 : 3);
+    }
+    return (10 - sum % 10) % 10;
+}
+
+function watchEncodes(c) {
+    var text = c.text || '';
+    var format = parseInt(c.format) || 0;
+    var accepts = WATCH_ENCODED_FORMATS[format];
+    if (accepts === undefined || text.length > MAX_TEXT_LEN || !accepts.test(text)) return false;
+    if (text.length !== GS1_CHECKED_LENGTH[format]) return true;
+    return gs1CheckDigit(text.slice(0, -1)) === text.charCodeAt(text.length - 1) - 48;
+}
+
+// --- Matrix Codec (mirrors codec.c on the watch) ---
+
+var CODEC_RAW = 0;        // MATRIX_CODEC_RAW
+var CODEC_ROW_RICE = 1;   // MATRIX_CODEC_ROW_RICE
+
+// Pack a continuous MSB-first matrix: XOR each module with the one above it,
+// then Rice-code the zero runs between the remaining ones with the best k.
+// Returns the packed bytes, or null when that wouldn't be smaller than raw.
+// Module matrices are dense (QR/Aztec data is ~50% dark at random), so this
+// mostly pays off on PDF417, whose start/stop columns repeat on every row.
+function packMatrix(width, height, bytes) {
+    var total = width * height;
+    var runs = [];
+    var run = 0;
+    for (var i = 0; i < total; i++) {
+        var bit = (bytes[i >> 3] >> (7 - (i & 7))) & 1;
+        if (i >= width) bit ^= (bytes[(i - width) >> 3] >> (7 - ((i - width) & 7))) & 1;
+        if (bit) { runs.push(run); run = 0; } else { run++; }
+    }
+    var tail = run;   // final run reaching the end (no terminating one)
+
+    var bestK = 0, bestBits = -1;
+    for (var k = 0; k < 8; k++) {
+        var bits = 0;
+        for (var r = 0; r < runs.length; r++) bits += (runs[r] >> k) + 1 + k;
+        if (tail > 0) bits += (tail >> k) + 1 + k;
+        if (bestBits < 0 || bits < bestBits) { bestBits = bits; bestK = k; }
+    }
+    if (1 + Math.ceil(bestBits / 8) >= bytes.length) return null;
+
+    var out = [bestK];
+    var acc = 0, nacc = 0;
+    function put(b) {
+        acc = (acc << 1) | b;
+        if (++nacc === 8) { out.push(acc); acc = 0; nacc = 0; }
+    }
+    function putRun(n) {
+        for (var q = n >> bestK; q > 0; q--) put(1);
+        put(0);
+        for (var j = bestK - 1; j >= 0; j--) put((n >> j) & 1);
+    }
+    for (var r2 = 0; r2 < runs.length; r2++) putRun(runs[r2]);
+    if (tail > 0) putRun(tail);
+    if (nacc > 0) out.push(acc << (8 - nacc));
+    return new Uint8Array(out);
+}
+
+// Cropped and packed matrices by source data ("w,h,hex"), kept in
+// localStorage so a REQUEST_CARDS sync (every launch) skips the work for
+// cards it has seen. Each sync keeps only the entries its cards used.
+// In memory an entry holds its Uint8Array; hex is only the stored form.
+var MATRIX_CACHE_KEY = 'pebble_wallet_matrices';
+var matrixCache = null;       // key -> { w, h, codec, raw, bytes } (oversize: { oversize })
+var matrixCacheUsed = null;   // entries the current sync used
+var matrixCacheDirty = false;
+
+function matrixCacheBegin() {
+    if (!matrixCache) {
+        var stored;
+        try {
+            stored = JSON.parse(localStorage.getItem(MATRIX_CACHE_KEY)) || {};
+        } catch (e) { stored = {}; }
+        matrixCache = {};
+        for (var key in stored) {
+            var s = stored[key];
+            matrixCache[key] = s.oversize ? s :
+                { w: s.w, h: s.h, codec: s.codec, raw: s.raw, bytes: hexToBytes(s.hex || '') };
+        }
+    }
+    matrixCacheUsed = {};
+    matrixCacheDirty = false;
+}
+
+function matrixCacheEnd() {
+    var pruned = Object.keys(matrixCache).length !== Object.keys(matrixCacheUsed).length;
+    matrixCache = matrixCacheUsed;
+    matrixCacheUsed = null;
+    if (matrixCacheDirty || pruned) {
+        var stored = {};
+        for (var key in matrixCache) {
+            var e = matrixCache[key];
+            stored[key] = e.oversize ? e :
+                { w: e.w, h: e.h, codec: e.codec, raw: e.raw, hex: bytesToHex(e.bytes) };
+        }
+        localStorage.setItem(MATRIX_CACHE_KEY, JSON.stringify(stored));
+    }
+}
+
+// Short key for a "w,h,hex" string: its length and an FNV-1a hash.
+function matrixKey(rawData) {
+    var h = 2166136261;
+    for (var i = 0; i < rawData.length; i++) {
+        h ^= rawData.charCodeAt(i);
+        h = (h * 403 + ((h << 24) >>> 0)) >>> 0;   // h * 16777619 mod 2^32
+    }
+    return rawData.length + ':' + h.toString(16);
+}
 
-// Turn a card into { width, height, bytes[] } using the config page's "w,h,hex".
+// Turn a card into { width, height, bytes } (a Uint8Array) using the config
+// page's "w,h,hex", through the matrix cache.
+// Width 0 with no bytes means "text only": the watch encodes it on load.
 function cardToMatrix(c) {
+    if (watchEncodes(c)) {
+        return { width: 0, height: 0, bytes: [], textOnly: true };
+    }
     var rawData = c.data || c.text || '';
     if (rawData.indexOf(',') === -1) {
         return { width: 0, height: 0, bytes: [] };
     }
-    var parts = rawData.split(',');
-    var opt = cropBitmap(parseInt(parts[0]), parseInt(parts[1]), parts[2]);
-    var bytes = [];
-    for (var i = 0; i < opt.hex.length; i += 2) {
-        bytes.push(parseInt(opt.hex.substr(i, 2), 16));
+    var key = matrixKey(rawData);
+    var e = matrixCache && matrixCache[key];
+    if (!e) {
+        e = matrixFromData(rawData);
+        if (matrixCache) matrixCache[key] = e;
+        matrixCacheDirty = true;
     }
-    if (bytes.length > MAX_CARD_BYTES) {
+    if (matrixCacheUsed) matrixCacheUsed[key] = e;
+    if (e.oversize) return { width: 0, height: 0, bytes: [], oversize: true };
+    return { width: e.w, height: e.h, bytes: e.bytes, codec: e.codec,
+             rawLength: e.raw, oversize: false };
+}
+
+// Crop and pack a "w,h,hex" matrix into a matrix cache entry.
+function matrixFromData(rawData) {
+    var parts = rawData.split(',');
+    var opt = cropBitmap(parseInt(parts[0]), parseInt(parts[1]), hexToBytes(parts[2] || ''));
+    if (opt.bytes.length > MAX_CARD_BYTES) {
         // Too big for the watch buffer. Sending a truncated matrix would render
         // a corrupt, unscannable partial — send nothing instead so the card is
         // clearly blank ("Resync from phone") rather than misleadingly wrong.
-        return { width: 0, height: 0, bytes: [], oversize: true };
+        return { oversize: true };
     }
-    return { width: opt.width, height: opt.height, bytes: bytes, oversize: false };
+    var packed = packMatrix(opt.width, opt.height, opt.bytes);
+    return { w: opt.width, h: opt.height, codec: packed ? CODEC_ROW_RICE : CODEC_RAW,
+             raw: opt.bytes.length, bytes: packed || opt.bytes };
 }
 
 // Send a queue of AppMessages one at a time, retrying each up to 5 times.
-function sendQueue(queue, idx, retries, onDone) {
+// Send messages in order, each as soon as the previous one is ACKed: the ACK
+// means the watch has handled it and its inbox is free. A NACK (inbox busy,
+// e.g. while a card is being persisted) backs off 50, 100, 200... ms; after
+// 5 NACKs in a row the queue gives up and calls onFail. `stats` (see
+// newSyncStats) counts ACKed messages, retries and backoff; with stats.acked
+// set, also each message's ACK time and its matrix bytes (stats.matrixBytes).
+function sendQueue(queue, idx, retries, onDone, onFail, stats) {
     if (idx >= queue.length) { if (onDone) onDone(); return; }
     Pebble.sendAppMessage(queue[idx], function() {
-        setTimeout(function() { sendQueue(queue, idx + 1, 0, onDone); }, 60);
+        if (stats) {
+            stats.messages++;
+            if (stats.acked) {
+                stats.acked[idx] = Date.now();
+                stats.bytes += stats.matrixBytes[idx] || 0;
+            }
+        }
+        sendQueue(queue, idx + 1, 0, onDone, onFail, stats);
     }, function(e) {
         if (retries < 5) {
-            setTimeout(function() { sendQueue(queue, idx, retries + 1, onDone); }, 200);
+            if (stats) { stats.retries++; stats.backoffMs += 50 << retries; }
+            setTimeout(function() { sendQueue(queue, idx, retries + 1, onDone, onFail, stats); }, 50 << retries);
         } else {
             console.log('Sync aborted at message ' + idx + ': ' + JSON.stringify(e));
+            if (onFail) onFail();
         }
     });
 }
 
-function syncToWatch(cards) {
+// --- Sync Telemetry ---
+
+// Phone side of one sync session (one attempt: a resume starts a new one).
+function newSyncStats() {
+    return { start: Date.now(), messages: 0, retries: 0, backoffMs: 0, bytes: 0,
+             acked: null, matrixBytes: null, cards: [] };
+}
+
+// KEY_SYNC_STATS, the watch's side, sent after CMD_SYNC_COMPLETE: little-endian
+// uint32s in this order (send_sync_stats in main.c).
+var WATCH_STATS_FIELDS = ['messages', 'bytes', 'ms', 'cards', 'cardMsTotal', 'cardMsMax',
+    'gaps', 'droppedBusy', 'droppedOverflow', 'droppedOther',
+    'persistWrites', 'persistBytes', 'persistMs', 'persistMsMax'];
+var WATCH_STATS_TIMEOUT_MS = 3000;   // older watch builds never send them
+
+function parseWatchStats(b) {
+    var out = {};
+    WATCH_STATS_FIELDS.forEach(function(name, i) {
+        out[name] = ((b[4 * i] | (b[4 * i + 1] << 8) | (b[4 * i + 2] << 16) |
+            (b[4 * i + 3] << 24)) >>> 0);
+    });
+    return out;
+}
+
+function rate(bytes, ms) {
+    return ms > 0 ? Math.round(bytes * 1000 / ms) + ' B/s' : '- B/s';
+}
+
+// One report per sync, both ends together, once the queue has ended and the
+// watch's numbers are in (`final`: they won't come, e.g. the sync aborted).
+// The time split says where a slow sync went: NACK backoff, flash writes on
+// the watch, or the link itself.
+function reportSync(sync, final) {
+    if (sync.reported || !sync.stats.end || (!sync.watchStats && !final)) return;
+    sync.reported = true;
+    var s = sync.stats, w = sync.watchStats;
+    var ms = s.end - s.start;
+    var lines = ['Sync report, attempt ' + (sync.attempt + 1) +
+        (sync.aborted ? ' (aborted)' : '') + ':',
+        '  phone: ' + s.messages + ' messages, ' + s.bytes + ' data bytes, ' + s.retries +
+            ' retries, ' + ms + ' ms (' + rate(s.bytes, ms) + ')'];
+    if (s.cards.length) {
+        lines.push('  cards: ' + s.cards.map(function(c) {
+            return '#' + c.index + ' ' + c.bytes + ' B ' + c.ms + ' ms';
+        }).join(', '));
+    }
+    if (w) {
+        lines.push('  watch: ' + w.messages + ' messages, ' + w.bytes + ' data bytes, ' + w.ms +
+            ' ms (' + rate(w.bytes, w.ms) + '), ' + w.cards + ' cards (' +
+            (w.cards ? Math.round(w.cardMsTotal / w.cards) : 0) + ' ms avg, ' + w.cardMsMax +
+            ' max), ' + w.gaps + ' gaps, dropped ' + w.droppedBusy + ' busy/' +
+            w.droppedOverflow + ' overflow/' + w.droppedOther + ' other');
+        lines.push('  persist: ' + w.persistWrites + ' writes, ' + w.persistBytes + ' bytes, ' +
+            w.persistMs + ' ms (max ' + w.persistMsMax + ')');
+        lines.push('  time: ' + w.persistMs + ' ms flash, ' + s.backoffMs + ' ms NACK backoff, ' +
+            Math.max(0, ms - w.persistMs - s.backoffMs) + ' ms link');
+    } else {
+        lines.push('  watch: no stats' + (sync.aborted ? '' : ' (older build?)'));
+        lines.push('  time: ' + s.backoffMs + ' ms NACK backoff, ' +
+            Math.max(0, ms - s.backoffMs) + ' ms link and watch');
+    }
+    console.log(lines.join('\n'));
+}
+
+// FNV-1a over everything the watch persists for a card, so an unchanged card
+// hashes the same across syncs. 0 means "no hash" on the watch, so avoid it.
+function cardHash(header, bytes) {
+    var h = 2166136261;
+    function mix(v) {
+        h ^= v & 0xFF;
+        h = (h * 403 + ((h << 24) >>> 0)) >>> 0;   // h * 16777619 mod 2^32
+    }
+    function mixString(s) {
+        for (var i = 0; i < s.length; i++) {
+            var cc = s.charCodeAt(i);
+            mix(cc); mix(cc >> 8);
+        }
+        mix(0);
+    }
+    mixString(header.KEY_NAME);
+    mixString(header.KEY_DESCRIPTION);
+    mixString(header.KEY_TEXT);
+    [header.KEY_FORMAT, header.KEY_WIDTH, header.KEY_HEIGHT, header.KEY_CODEC].forEach(function(v) {
+        mix(v); mix(v >> 8);
+    });
+    for (var i = 0; i < bytes.length; i++) mix(bytes[i]);
+    return h || 1;
+}
+
+function u32le(v) {
+    return [v & 0xFF, (v >>> 8) & 0xFF, (v >>> 16) & 0xFF, (v >>> 24) & 0xFF];
+}
+
+function u16le(v) {
+    return [v & 0xFF, (v >> 8) & 0xFF];
+}
+
+// UTF-8 bytes of a string, cut to at most `max` bytes.
+function utf8Bytes(s, max) {
+    var u = unescape(encodeURIComponent(s || ''));
+    var out = [];
+    for (var i = 0; i < u.length && i < max; i++) out.push(u.charCodeAt(i));
+    return out;
+}
+
+// A card's FRAME_CARD record, from its planned header.
+function cardRecord(h) {
+    var name = utf8Bytes(h.KEY_NAME, MAX_FIELD_BYTES);
+    var desc = utf8Bytes(h.KEY_DESCRIPTION, MAX_FIELD_BYTES);
+    var text = utf8Bytes(h.KEY_TEXT, MAX_TEXT_LEN);
+    var body = [h.KEY_INDEX, h.KEY_FORMAT, h.KEY_CODEC, name.length, desc.length, text.length]
+        .concat(u16le(h.KEY_WIDTH), u16le(h.KEY_HEIGHT), u16le(h.KEY_DATA_LEN), h.KEY_HASH,
+                name, desc, text);
+    return [FRAME_CARD].concat(u16le(body.length), body);
+}
+
+// Delta sync in flight: cards (header + chunk messages) waiting for the
+// watch's KEY_NEED reply to CMD_SYNC_START.
+var pendingSync = null;
+var latestSync = null;   // the most recent sync, waiting or sending
+var NEED_TIMEOUT_MS = 5000;   // no reply (older watch build): send every card
+
+// A sync cut off on a weak link is resumed, not restarted: the delta handshake
+// runs again, so cards the watch committed are kept, and the watch's
+// KEY_RESUME lets the card it was halfway through continue where it stopped.
+var MAX_RESUMES = 3;
+var RESUME_DELAY_MS = 2000;   // x attempt number
+
+function resumeLater(sync) {
+    if (sync !== latestSync) return;   // a newer sync took over
+    var attempt = (sync.attempt || 0) + 1;
+    if (attempt > MAX_RESUMES) {
+        console.log('Sync gave up after ' + MAX_RESUMES + ' resumes');
+        return;
+    }
+    console.log('Resuming sync in ' + (RESUME_DELAY_MS * attempt) + ' ms (attempt ' + attempt + ')');
+    setTimeout(function() { syncToWatch(sync.cards, attempt); }, RESUME_DELAY_MS * attempt);
+}
+
+function syncToWatch(cards, attempt) {
     console.log('Syncing ' + cards.length + ' cards to watch');
-    var queue = [{ 'CMD_SYNC_START': 1 }];
-    var projected = 16;  // small global overhead
+    var budget = loadBudget();
+    var plan = [];
+    var projected = 0;   // record bytes: packed back to back in the page heap
 
-    var synced = 0, dropped = 0;
-    for (var index = 0; index < cards.length && synced < 10; index++) {
+    var dropped = 0;
+    matrixCacheBegin();
+    for (var index = 0; index < cards.length && plan.length < MAX_CARDS; index++) {
         var c = cards[index];
         var m = cardToMatrix(c);
-        // The raw text rides in the header so the watch can show it on demand.
+        // The raw text rides in the header so the watch can show it on demand;
+        // it costs the UTF-8 bytes cardRecord sends, not its UTF-16 length.
         var cardText = (c.text || '').substring(0, MAX_TEXT_LEN);
-        var cost = PER_CARD_OVERHEAD + m.bytes.length + cardText.length;
+        var cost = budget.recordHeader + fieldCost(c.name) + fieldCost(c.description) +
+            m.bytes.length + utf8Bytes(cardText, MAX_TEXT_LEN).length;
 
-        // Blocking budget guard: never queue a card that would push the watch
-        // past its ~4KB persist limit — a partially-persisted card renders as a
-        // truncated, unscannable barcode. Skip it (and warn) instead.
-        if (projected + cost > STORAGE_BUDGET) {
+        // Blocking budget guard: never queue a card the watch would refuse for
+        // lack of persist space (it would show as missing). Skip it (and warn)
+        // instead; a smaller card further down may still fit.
+        var charged = projected + cost + budget.perCard * (plan.length + 1);
+        if (projected + cost > budget.heapMax || charged > budget.capacity) {
             dropped++;
-            console.log('Storage budget reached (' + projected + '/' + STORAGE_BUDGET +
-                ' bytes) — skipping card "' + c.name + '".');
+            console.log('Storage budget reached (' + (projected + budget.perCard * plan.length) +
+                '/' + budget.capacity + ' bytes) — skipping card "' + c.name + '".');
             continue;
         }
         projected += cost;
 
-        queue.push({
+        var synced = plan.length;
+        var header = {
             'KEY_INDEX': synced,
             'KEY_NAME': c.name || '',
             'KEY_DESCRIPTION': c.description || '',
@@ -174,33 +571,133 @@ function syncToWatch(cards) {
             'KEY_WIDTH': m.width,
             'KEY_HEIGHT': m.height,
             'KEY_DATA_LEN': m.bytes.length,
+            'KEY_CODEC': m.codec || CODEC_RAW,
             'KEY_TEXT': cardText
-        });
+        };
+        var hash = cardHash(header, m.bytes);
+        header['KEY_HASH'] = u32le(hash);
 
-        for (var off = 0; off < m.bytes.length; off += CHUNK_SIZE) {
-            queue.push({
-                'KEY_INDEX': synced,
-                'KEY_DATA_OFFSET': off,
-                'KEY_DATA': m.bytes.slice(off, off + CHUNK_SIZE)
-            });
-        }
         if (m.oversize) {
             console.log('WARNING: card "' + c.name + '" barcode is too large for the ' +
                 'watch (>' + MAX_CARD_BYTES + ' bytes) — sent blank. Use fewer characters ' +
                 'or a denser format.');
         }
-        console.log('Queued card ' + synced + ': ' + c.name +
-            ' ' + m.width + 'x' + m.height + ' (' + m.bytes.length + ' bytes)');
-        synced++;
+        console.log('Planned card ' + synced + ': ' + c.name + (m.textOnly ? ' (text only)' :
+            ' ' + m.width + 'x' + m.height + ' (' + m.bytes.length + ' bytes' +
+            (m.codec === CODEC_ROW_RICE ? ', packed from ' + m.rawLength : '') + ')'));
+        plan.push({ hash: hash, header: header, bytes: m.bytes });
     }
 
-    queue.push({ 'CMD_SYNC_COMPLETE': 1 });
+    matrixCacheEnd();
 
     if (dropped > 0) {
         console.log('NOTE: ' + dropped + ' card(s) did not fit in Pebble storage and were skipped.');
     }
 
-    sendQueue(queue, 0, 0, function() { console.log('Sync complete (' + synced + ' cards)'); });
+    // Manifest: each card's content hash, in order. The watch keeps the cards it
+    // already has and answers with KEY_NEED = [count, index...].
+    var manifest = [];
+    plan.forEach(function(p) { manifest = manifest.concat(u32le(p.hash)); });
+    var sync = { cards: cards, plan: plan, done: false, attempt: attempt || 0,
+                 stats: newSyncStats(), watchStats: null };
+    pendingSync = sync;
+    latestSync = sync;
+    sendQueue([{ 'CMD_SYNC_START': 1, 'KEY_MANIFEST': manifest }], 0, 0, function() {
+        setTimeout(function() {
+            if (!sync.done) {
+                console.log('No delta reply from watch, sending all cards');
+                sendPlannedCards(sync, null, null);
+            }
+        }, NEED_TIMEOUT_MS);
+    }, function() {
+        if (pendingSync === sync) pendingSync = null;
+        sync.done = true;
+        abortSync(sync);
+    }, sync.stats);
+}
+
+// Send the cards the watch asked for (all of them if `need` is null). `resume`
+// ({index, offset}, from KEY_RESUME) is a card whose header and first `offset`
+// bytes the watch already holds: only the rest of it is sent.
+function sendPlannedCards(sync, need, resume) {
+    if (sync.done || sync !== pendingSync) return;
+    sync.done = true;
+    pendingSync = null;
+    var chunk = loadChunkSize();
+    var queue = [];
+    var matrixBytes = [];   // per message, for the sync report
+    var frame = [SYNC_FRAME_VERSION], frameBytes = 0;
+    function flush() {
+        if (frame.length > 1) {
+            queue.push({ 'KEY_FRAMES': frame });
+            matrixBytes.push(frameBytes);
+        }
+        frame = [SYNC_FRAME_VERSION];
+        frameBytes = 0;
+    }
+
+    var spans = [];   // per card: its messages in the queue, for per-card timing
+    var sent = 0, bytes = 0;
+    sync.plan.forEach(function(p, i) {
+        var len = p.bytes.length;
+        if (need && need.indexOf(i) < 0) return;
+        var from = 0;
+        if (resume && resume.index === i && resume.offset < len) {
+            from = resume.offset;   // header already there
+        } else {
+            // A record bigger than a message (only before the watch has
+            // reported its inbox) goes alone; the inbox is larger anyway.
+            var rec = cardRecord(p.header);
+            if (frame.length + rec.length > chunk) flush();
+            frame = frame.concat(rec);
+        }
+        var first = queue.length;   // the message being filled
+        for (var off = from; off < len; ) {
+            var room = chunk - frame.length - FRAME_RECORD_HEADER - FRAME_DATA_FIXED;
+            if (room < MIN_DATA_RECORD && frame.length > 1) { flush(); continue; }
+            var n = Math.min(Math.max(room, MIN_DATA_RECORD), len - off);
+            frame.push(FRAME_DATA, (n + FRAME_DATA_FIXED) & 0xFF, (n + FRAME_DATA_FIXED) >> 8,
+                       p.header.KEY_INDEX, off & 0xFF, off >> 8);
+            for (var k = 0; k < n; k++) frame.push(p.bytes[off + k]);
+            frameBytes += n;
+            off += n;
+        }
+        bytes += len - from;
+        spans.push({ index: i, first: first, last: queue.length, bytes: len - from });
+        sent++;
+    });
+    if (frame.length > 1) {
+        queue.push({ 'KEY_FRAMES': frame, 'CMD_SYNC_COMPLETE': 1 });
+        matrixBytes.push(frameBytes);
+    } else {
+        queue.push({ 'CMD_SYNC_COMPLETE': 1 });
+    }
+    console.log('Sending ' + sent + ' of ' + sync.plan.length + ' cards (' +
+        (sync.plan.length - sent) + ' unchanged on watch) in ' + queue.length +
+        ' messages of up to ' + chunk + ' bytes');
+    var stats = sync.stats;
+    stats.matrixBytes = matrixBytes;
+    var start = Date.now();
+    stats.acked = [];
+    sendQueue(queue, 0, 0, function() {
+        stats.end = Date.now();
+        stats.cards = spans.map(function(c) {
+            var from = c.first > 0 ? stats.acked[c.first - 1] : start;
+            return { index: c.index, bytes: c.bytes, ms: stats.acked[c.last] - from };
+        });
+        console.log('Sync complete (' + sent + ' cards, ' + bytes + ' data bytes, ' +
+            (stats.end - start) + ' ms)');
+        reportSync(sync);   // if the watch's stats beat the last ACK
+        setTimeout(function() { reportSync(sync, true); }, WATCH_STATS_TIMEOUT_MS);
+    }, function() { abortSync(sync); }, stats);
+}
+
+// The send queue gave up: report what got through, then resume.
+function abortSync(sync) {
+    sync.stats.end = Date.now();
+    sync.aborted = true;
+    reportSync(sync, true);
+    resumeLater(sync);
 }
 
 // --- Events ---
@@ -210,10 +707,30 @@ Pebble.addEventListener('ready', function() {
 });
 
 Pebble.addEventListener('appmessage', function(event) {
+    var budgetChanged = saveBudget(event.payload.KEY_BUDGET);
+    saveChunkSize(event.payload.KEY_CHUNK_MAX);
+    if (event.payload.KEY_SYNC_STATS && latestSync) {
+        latestSync.watchStats = parseWatchStats(event.payload.KEY_SYNC_STATS);
+        reportSync(latestSync);   // waits for the queue to drain if it hasn't
+    }
     if (event.payload.REQUEST_CARDS) {
         console.log('Watch requested cards');
         syncToWatch(loadCards());
     }
+    if (event.payload.KEY_NEED !== undefined && pendingSync) {
+        if (budgetChanged) {
+            // Planned against a stale guess: plan again with the real numbers.
+            console.log('Re-planning sync against the reported budget');
+            pendingSync.done = true;
+            syncToWatch(pendingSync.cards, pendingSync.attempt);
+            return;
+        }
+        var reply = event.payload.KEY_NEED;
+        var r = event.payload.KEY_RESUME;
+        var resume = r && r.length >= 3 ? { index: r[0], offset: r[1] | (r[2] << 8) } : null;
+        if (resume) console.log('Watch resumes card ' + resume.index + ' at byte ' + resume.offset);
+        sendPlannedCards(pendingSync, reply.slice(1, 1 + reply[0]), resume);
+    }
 });
 
 Pebble.addEventListener('showConfiguration', function() {
@@ -0,0 +1,208 @@
+#include "common.h"
+#include <string.h>
+
+// ============================================================================
+// 1D Encoders - EAN-13 / EAN-8 / UPC-A, Code 39 and ITF
+// On-watch encoding for cards synced as text: a few digits instead of a bit
+// row. Check digits are computed when left off (and verified when present),
+// and the output is the one-row packed bitmap draw_1d_rotated expects.
+// Code 39 uses a 2:1 wide:narrow ratio like the config page; ITF uses 3:1 up
+// to ITF-14 length and 2:1 beyond, so longer numbers still fit the screen.
+// ============================================================================
+
+// --- Row Writer ---
+
+typedef struct {
+    uint8_t *out;
+    int out_len;
+    int pos;        // modules written
+    bool overflow;
+} Row;
+
+static void row_begin(Row *r, uint8_t *out, int out_len) {
+    r->out = out;
+    r->out_len = out_len;
+    r->pos = 0;
+    r->overflow = false;
+    memset(out, 0, out_len);
+}
+
+static void put_run(Row *r, bool dark, int n) {
+    for (int i = 0; i < n; i++, r->pos++) {
+        if ((r->pos >> 3) >= r->out_len) {
+            r->overflow = true;
+            return;
+        }
+        if (dark) r->out[r->pos >> 3] |= (uint8_t)(0x80 >> (r->pos & 7));
+    }
+}
+
+// `n` modules MSB first, 1 = bar.
+static void put_bits(Row *r, uint32_t bits, int n) {
+    for (int i = n - 1; i >= 0; i--) put_run(r, (bits >> i) & 1, 1);
+}
+
+static bool row_end(Row *r, uint16_t *out_width) {
+    if (r->overflow) return false;
+    *out_width = (uint16_t)r->pos;
+    return true;
+}
+
+static bool all_digits(const char *s, int n) {
+    for (int i = 0; i < n; i++) if (s[i] < '0' || s[i] > '9') return false;
+    return n > 0;
+}
+
+// GS1 mod-10 check digit of d[0..n): weights 3, 1, 3... from the right.
+static int gs1_check_digit(const char *d, int n) {
+    int sum = 0;
+    for (int i = 0; i < n; i++) sum += (d[n - 1 - i] - '0') * ((i & 1) ? 1 : 3);
+    return (10 - sum % 10) % 10;
+}
+
+// ============================================================================
+// EAN-13 / EAN-8 / UPC-A
+// UPC-A is EAN-13 with a leading 0. In EAN-13 the first digit isn't drawn: it
+// selects the L/G parity of the next six.
+// ============================================================================
+
+static const uint8_t EAN_L[10] = {
+    0x0D, 0x19, 0x13, 0x3D, 0x23, 0x31, 0x2F, 0x3B, 0x37, 0x0B
+};
+// G = L's complement, mirrored; R = L's complement.
+static const uint8_t EAN_G[10] = {
+    0x27, 0x33, 0x1B, 0x21, 0x1D, 0x39, 0x05, 0x11, 0x09, 0x17
+};
+// Parity of digits 2-7 per leading digit, bit 5 = digit 2, 1 = G.
+static const uint8_t EAN_PARITY[10] = {
+    0x00, 0x0B, 0x0D, 0x0E, 0x13, 0x19, 0x1C, 0x15, 0x16, 0x1A
+};
+
+#define EAN_GUARD 0x5    // 101
+#define EAN_CENTER 0xA   // 01010
+
+bool ean_encode(BarcodeFormat format, const char *text, uint8_t *out, int out_len,
+                uint16_t *out_width) {
+    int total = format == FORMAT_EAN8 ? 8 : format == FORMAT_UPCA ? 12 : 13;
+    int n = strlen(text);
+    if ((n != total && n != total - 1) || !all_digits(text, n)) return false;
+
+    // Digits as EAN-13/EAN-8, check digit appended or verified.
+    char d[14];
+    int len = 0;
+    if (format == FORMAT_UPCA) d[len++] = '0';
+    memcpy(d + len, text, n);
+    len += n;
+    int check = gs1_check_digit(d, len - (n == total ? 1 : 0));
+    if (n == total) {
+        if (d[len - 1] - '0' != check) return false;
+    } else {
+        d[len++] = (char)('0' + check);
+    }
+
+    Row r;
+    row_begin(&r, out, out_len);
+    put_bits(&r, EAN_GUARD, 3);
+    if (len == 8) {
+        for (int i = 0; i < 4; i++) put_bits(&r, EAN_L[d[i] - '0'], 7);
+        put_bits(&r, EAN_CENTER, 5);
+        for (int i = 4; i < 8; i++) put_bits(&r, ~EAN_L[d[i] - '0'] & 0x7F, 7);
+    } else {
+        uint8_t parity = EAN_PARITY[d[0] - '0'];
+        for (int i = 1; i < 7; i++) {
+            int v = d[i] - '0';
+            put_bits(&r, (parity >> (6 - i)) & 1 ? EAN_G[v] : EAN_L[v], 7);
+        }
+        put_bits(&r, EAN_CENTER, 5);
+        for (int i = 7; i < 13; i++) put_bits(&r, ~EAN_L[d[i] - '0'] & 0x7F, 7);
+    }
+    put_bits(&r, EAN_GUARD, 3);
+    return row_end(&r, out_width);
+}
+
+// ============================================================================
+// Code 39
+// 9 elements per character (5 bars, 4 spaces, 3 of them wide), framed by '*'
+// and separated by a narrow space. No check character, as on the phone.
+// ============================================================================
+
+static const char CODE39_CHARS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ-. $/+%";
+// Wide-element flags, first element in bit 8.
+static const uint16_t CODE39_WIDE[] = {
+    0x034, 0x121, 0x061, 0x160, 0x031, 0x130, 0x070, 0x025, 0x124, 0x064,   // 0-9
+    0x109, 0x049, 0x148, 0x019, 0x118, 0x058, 0x00D, 0x10C, 0x04C, 0x01C,   // A-J
+    0x103, 0x043, 0x142, 0x013, 0x112, 0x052, 0x007, 0x106, 0x046, 0x016,   // K-T
+    0x181, 0x0C1, 0x1C0, 0x091, 0x190, 0x0D0, 0x085, 0x184, 0x0C4, 0x0A8,   // U-$
+    0x0A2, 0x08A, 0x02A                                                      // / + %
+};
+#define CODE39_STAR 0x094
+#define CODE39_WIDE_MODULES 2
+
+static void put_code39_char(Row *r, uint16_t wide) {
+    for (int e = 0; e < 9; e++) {
+        put_run(r, !(e & 1), (wide >> (8 - e)) & 1 ? CODE39_WIDE_MODULES : 1);
+    }
+}
+
+bool code39_encode(const char *text, uint8_t *out, int out_len, uint16_t *out_width) {
+    int n = strlen(text);
+    if (n == 0) return false;
+
+    Row r;
+    row_begin(&r, out, out_len);
+    put_code39_char(&r, CODE39_STAR);
+    for (int i = 0; i < n; i++) {
+        const char *p = text[i] ? strchr(CODE39_CHARS, text[i]) : NULL;
+        if (!p) return false;
+        put_run(&r, false, 1);
+        put_code39_char(&r, CODE39_WIDE[p - CODE39_CHARS]);
+    }
+    put_run(&r, false, 1);
+    put_code39_char(&r, CODE39_STAR);
+    return row_end(&r, out_width);
+}
+
+// ============================================================================
+// ITF (Interleaved 2 of 5)
+// Digits in pairs: the first is drawn in the bars, the second in the spaces.
+// 13 digits get a GS1 check digit (ITF-14); other odd lengths get a leading 0.
+// ============================================================================
+
+// Wide flags for the 5 elements of each digit, first element in bit 4.
+static const uint8_t ITF_WIDE[10] = {
+    0x06, 0x11, 0x09, 0x18, 0x05, 0x14, 0x0C, 0x03, 0x12, 0x0A
+};
+#define ITF14_DIGITS 14
+
+bool itf_encode(const char *text, uint8_t *out, int out_len, uint16_t *out_width) {
+    int n = strlen(text);
+    if (n > MAX_TEXT_LEN || !all_digits(text, n)) return false;
+
+    char d[MAX_TEXT_LEN + 1];
+    int len = 0;
+    if (n == ITF14_DIGITS - 1) {
+        memcpy(d, text, n);
+        d[n] = (char)('0' + gs1_check_digit(text, n));
+        len = n + 1;
+    } else {
+        if (n & 1) d[len++] = '0';
+        memcpy(d + len, text, n);
+        len += n;
+    }
+    int wide = len <= ITF14_DIGITS ? 3 : 2;
+
+    Row r;
+    row_begin(&r, out, out_len);
+    put_bits(&r, 0xA, 4);   // start: narrow bar, space, bar, space
+    for (int i = 0; i < len; i += 2) {
+        uint8_t bars = ITF_WIDE[d[i] - '0'], spaces = ITF_WIDE[d[i + 1] - '0'];
+        for (int e = 4; e >= 0; e--) {
+            put_run(&r, true, (bars >> e) & 1 ? wide : 1);
+            put_run(&r, false, (spaces >> e) & 1 ? wide : 1);
+        }
+    }
+    put_run(&r, true, wide);   // stop: wide bar, narrow space, narrow bar
+    put_run(&r, false, 1);
+    put_run(&r, true, 1);
+    return row_end(&r, out_width);
+}
@@ -2,7 +2,6 @@
 #include <string.h>
 
 // --- Global State ---
-WalletCardInfo g_cards[MAX_CARDS];
 int g_card_count = 0;
 uint8_t g_active_bits[MAX_BITS_LEN];
 
@@ -23,18 +22,79 @@ static bool s_text_mode = false;
 static int s_text_scroll = 0;
 static char s_detail_text[MAX_TEXT_LEN + 1];
 
-// Raw text for the card currently being received over the sync stream. It rides
-// in the header message, so stash it until the matrix finishes and we persist.
-static char s_rx_text[MAX_TEXT_LEN + 1];
-static int s_rx_text_len = 0;
-
-// Chunked-sync reassembly state. A card arrives as one header message
-// (KEY_DATA_LEN) followed by N data-chunk messages (KEY_DATA_OFFSET + KEY_DATA).
-// Chunks are reassembled into g_active_bits (reused as staging to save RAM on
-// aplite) and flushed to storage once the whole matrix has arrived.
+// Module matrix in g_active_bits for the current card. Phone-rendered cards use
+// their stored dimensions; text-only cards are encoded on load and get the
+// encoder's. 0x0 = nothing drawable (g_active_bits then holds the text, if any).
+static uint16_t s_active_width = 0;
+static uint16_t s_active_height = 0;
+
+// Demo cards are showing (no persisted cards and the phone didn't answer).
+static bool s_demo_cards = false;
+
+// Info of the card open in the detail view. A copy: storage pages card info in
+// and out of a small cache, so a pointer from card_info() doesn't stay valid.
+static WalletCardInfo s_card;
+
+// Rendered-barcode cache. The current card's code is drawn once into an
+// offscreen 1-bit bitmap, and redraws that don't change the code (backlight
+// toggle, flipping back from text mode) just blit it. Keyed by card index and
+// layer size; dropped when the card changes or a sync overwrites it. Skipped
+// (live drawing instead) when the heap can't spare it plus a reserve, which on
+// aplite keeps it from eating into the small app heap.
+static GBitmap *s_code_cache = NULL;
+static int s_code_cache_index = -1;
+static GSize s_code_cache_size;
+#if defined(PBL_PLATFORM_APLITE)
+#define CODE_CACHE_HEAP_RESERVE 6000
+#else
+#define CODE_CACHE_HEAP_RESERVE 4000
+#endif
+
+// Chunked-sync receive state. A card arrives as a header record followed by
+// data records (see rx_frames), several to a message when they fit.
+// The header opens a record in storage (storage_card_stream_begin, which also
+// writes the raw text riding in it) and each data record is written from the
+// message straight into its page, so receiving needs no staging buffer and leaves
+// g_active_bits (the card on screen) alone. The matrix stays in the codec the
+// phone chose (KEY_CODEC) and is only unpacked on load. Only the contiguous
+// prefix counts as received: a chunk past it (one lost in between) is ignored,
+// and a resumed sync continues from the prefix.
 static int s_rx_index = -1;    // card index currently being received (-1 = none)
 static int s_rx_expected = 0;  // total matrix bytes expected for this card
-static int s_rx_received = 0;  // bytes reassembled so far
+static uint32_t s_rx_hash = 0; // its content hash, to match it on a resume
+
+// The inbox is opened as large as the watch allows (up to SYNC_INBOX_MAX), and
+// the phone packs frames up to it (KEY_CHUNK_MAX), so a 1400-byte boarding
+// pass is one message, and so is a wallet of small text-only cards.
+#define SYNC_INBOX_MAX 2048
+static int s_chunk_max = 0;
+
+// Sync telemetry, from CMD_SYNC_START to CMD_SYNC_COMPLETE: logged, and sent
+// back to the phone as KEY_SYNC_STATS (see send_sync_stats) so it can report
+// both ends of the link together.
+static struct {
+    uint64_t start_ms;
+    uint64_t card_start_ms;   // header of the card being received
+    int messages;
+    int bytes;                // matrix bytes received
+    int cards;                // cards committed
+    int card_ms_total;
+    int card_ms_max;
+    int gaps;                 // chunks ignored past the received prefix
+    int dropped_busy;         // inbox drops by reason
+    int dropped_overflow;
+    int dropped_other;
+} s_sync;
+
+static uint64_t now_ms(void) {
+    time_t s;
+    uint16_t ms;
+    time_ms(&s, &ms);
+    return (uint64_t)s * 1000 + ms;
+}
+
+#define DETAIL_NAME_H 22   // top strip showing the card name
+#define TEXT_VIEW_FONT FONT_KEY_GOTHIC_24_BOLD
 
 // Forward declarations
 static void request_cards_from_phone(void *data);
@@ -42,181 +102,397 @@ static void load_current_card_data(void);
 
 // ============================================================================
 // Demo Cards (fallback when no phone and no persisted cards)
-// Demo cards use width=0, height=0 to trigger on-watch Code128/QR fallback.
-// The raw text is stored in g_active_bits when the demo card is viewed.
+// Demo cards use width=0, height=0 like any text-only card: their text is
+// encoded on the watch when the card is opened.
 // ============================================================================
 
-// Static text buffers for demo card data (loaded into g_active_bits on demand)
-static const char *s_demo_data[] = {
-    "6035550123456789",   // Starbucks
-    "4012345678901",      // Target
-    "29857341",           // Library
-    "M1DOE/JOHN E ABC123" // Demo Flight (short enough for on-watch QR)
+static const struct {
+    const char *name;
+    const char *description;
+    BarcodeFormat format;
+    const char *text;
+} DEMO_CARDS[] = {
+    { "Starbucks", "Rewards Card", FORMAT_CODE128, "6035550123456789" },
+    { "Target Circle", "Loyalty Program", FORMAT_CODE128, "4012345678901" },
+    { "Library Card", "Public Library", FORMAT_CODE128, "29857341" },
+    // Short enough for on-watch QR.
+    { "Demo Flight", "JFK to LAX", FORMAT_QR, "M1DOE/JOHN E ABC123" },
 };
+#define DEMO_CARD_COUNT ((int)(sizeof(DEMO_CARDS) / sizeof(DEMO_CARDS[0])))
 
 static void add_demo_cards(void) {
-    strncpy(g_cards[0].name, "Starbucks", MAX_NAME_LEN - 1);
-    strncpy(g_cards[0].description, "Rewards Card", MAX_NAME_LEN - 1);
-    g_cards[0].format = FORMAT_CODE128;
-    g_cards[0].width = 0; g_cards[0].height = 0; g_cards[0].data_len = 0;
-
-    strncpy(g_cards[1].name, "Target Circle", MAX_NAME_LEN - 1);
-    strncpy(g_cards[1].description, "Loyalty Program", MAX_NAME_LEN - 1);
-    g_cards[1].format = FORMAT_CODE128;
-    g_cards[1].width = 0; g_cards[1].height = 0; g_cards[1].data_len = 0;
-
-    strncpy(g_cards[2].name, "Library Card", MAX_NAME_LEN - 1);
-    strncpy(g_cards[2].description, "Public Library", MAX_NAME_LEN - 1);
-    g_cards[2].format = FORMAT_CODE128;
-    g_cards[2].width = 0; g_cards[2].height = 0; g_cards[2].data_len = 0;
-
-    strncpy(g_cards[3].name, "Demo Flight", MAX_NAME_LEN - 1);
-    strncpy(g_cards[3].description, "JFK to LAX", MAX_NAME_LEN - 1);
-    g_cards[3].format = FORMAT_QR;
-    g_cards[3].width = 0; g_cards[3].height = 0; g_cards[3].data_len = 0;
-
-    g_card_count = 4;
-}
-
-// Load demo card text data into g_active_bits as a null-terminated string
-static bool load_demo_data(int index) {
-    if (index < 0 || index >= 4) return false;
-    int len = strlen(s_demo_data[index]);
-    if (len >= MAX_BITS_LEN) len = MAX_BITS_LEN - 1;
-    memcpy(g_active_bits, s_demo_data[index], len);
-    g_active_bits[len] = '\0';
+    g_card_count = DEMO_CARD_COUNT;
+    s_demo_cards = true;
+}
+
+// Load demo card text into `buffer` as a null-terminated string
+static bool load_demo_text(int index, char *buffer, int max_len) {
+    if (index < 0 || index >= DEMO_CARD_COUNT) return false;
+    strncpy(buffer, DEMO_CARDS[index].text, max_len - 1);
+    buffer[max_len - 1] = '\0';
     return true;
 }
 
+// Info for card `index`: the demo table, or paged in from storage. NULL if the
+// card hasn't been synced yet. Valid until the next call (copy to keep it).
+static const WalletCardInfo *card_info(int index) {
+    if (!s_demo_cards) return storage_card_info(index);
+    if (index < 0 || index >= DEMO_CARD_COUNT) return NULL;
+    static WalletCardInfo demo;
+    memset(&demo, 0, sizeof(demo));
+    strncpy(demo.name, DEMO_CARDS[index].name, MAX_NAME_LEN - 1);
+    strncpy(demo.description, DEMO_CARDS[index].description, MAX_NAME_LEN - 1);
+    demo.format = DEMO_CARDS[index].format;
+    return &demo;
+}
+
+// ============================================================================
+// Rendered-Barcode Cache
+// ============================================================================
+
+static void code_cache_drop(void) {
+    if (s_code_cache) gbitmap_destroy(s_code_cache);
+    s_code_cache = NULL;
+    s_code_cache_index = -1;
+}
+
+// Area below the name strip that the barcode is drawn into.
+static GRect detail_code_bounds(GRect bounds) {
+    return GRect(bounds.origin.x, bounds.origin.y + DETAIL_NAME_H,
+                 bounds.size.w, bounds.size.h - DETAIL_NAME_H);
+}
+
+// Render the current card into the cache unless it already holds it at `size`.
+static void code_cache_build(GSize size) {
+    if (s_current_index < 0 || s_current_index >= g_card_count) return;
+    if (s_code_cache && s_code_cache_index == s_current_index &&
+        s_code_cache_size.w == size.w && s_code_cache_size.h == size.h) return;
+    code_cache_drop();
+
+    if (s_active_width == 0 || s_active_height == 0) return;   // nothing to draw
+    int bytes = ((size.w + 31) / 32) * 4 * size.h;        // 1-bit rows are word-aligned
+    if ((int)heap_bytes_free() < bytes + CODE_CACHE_HEAP_RESERVE) return;
+
+    s_code_cache = barcode_render_bitmap(size, s_card.format,
+                                         s_active_width, s_active_height, g_active_bits);
+    if (s_code_cache) {
+        s_code_cache_index = s_current_index;
+        s_code_cache_size = size;
+    }
+}
+
 // ============================================================================
 // AppMessage Handling
 // ============================================================================
 
-// Persist a fully-reassembled card and refresh the menu.
+// Commit a fully-received card and refresh the menu, and the detail view if
+// it is showing this card.
 static void finalize_rx_card(int i) {
-    g_cards[i].text_len = (uint16_t)s_rx_text_len;
-    bool ok = storage_save_card(i, &g_cards[i], g_active_bits, s_rx_expected,
-                                s_rx_text, s_rx_text_len);
+    bool ok = storage_card_stream_commit();
+    int ms = (int)(now_ms() - s_sync.card_start_ms);
+    s_sync.cards++;
+    s_sync.card_ms_total += ms;
+    if (ms > s_sync.card_ms_max) s_sync.card_ms_max = ms;
     if (i >= g_card_count) {
         g_card_count = i + 1;
         storage_save_count(g_card_count);
     }
-    APP_LOG(ok ? APP_LOG_LEVEL_INFO : APP_LOG_LEVEL_WARNING,
-            "Card %d: %s (%dx%d, %d bytes, fmt=%d)%s",
-            i, g_cards[i].name, g_cards[i].width, g_cards[i].height,
-            s_rx_expected, (int)g_cards[i].format,
-            ok ? "" : " [STORAGE FULL - may be truncated]");
+    const WalletCardInfo *c = storage_card_info(i);
+    APP_LOG(ok ? APP_LOG_LEVEL_INFO : APP_LOG_LEVEL_WARNING, "Card %d: %s (%dx%d, %d bytes, fmt=%d, codec=%d)%s",
+            i, c ? c->name : "?", c ? c->width : 0, c ? c->height : 0,
+            s_rx_expected, c ? (int)c->format : -1, c ? (int)c->codec : -1,
+            ok ? "" : " [write failed]");
     s_rx_index = -1;
     s_rx_expected = 0;
-    s_rx_received = 0;
-    s_rx_text_len = 0;
     s_loading = false;
     menu_layer_reload_data(s_menu_layer);
+    if (i == s_current_index && s_barcode_layer &&
+        window_stack_get_top_window() == s_detail_window) {
+        load_current_card_data();
+        layer_mark_dirty(s_barcode_layer);
+    }
 }
 
-static void inbox_received_handler(DictionaryIterator *iter, void *context) {
-    // 1. Sync start (clears watch for incoming sync)
-    if (dict_find(iter, MESSAGE_KEY_CMD_SYNC_START)) {
-        g_card_count = 0;
-        storage_save_count(0);
-        storage_wipe_all_cards();  // free orphaned data from a previous larger sync
-        s_rx_index = -1;
-        s_rx_expected = 0;
-        s_rx_received = 0;
-        s_loading = false;
-        menu_layer_reload_data(s_menu_layer);
-        return;
+// Little-endian integers from byte arrays (hashes travel as 4 bytes, since
+// PebbleKit JS only sends signed 32-bit integers).
+static uint32_t read_u32le(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+static uint16_t read_u16le(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// What the phone plans a sync against, on every message that leads to one:
+// KEY_BUDGET, what a card set may use on this watch as little-endian uint16s
+// [capacity, heap_max, per_card, record_header] (see StorageUsage), and
+// KEY_CHUNK_MAX, the largest KEY_FRAMES payload the inbox takes.
+static void write_sync_limits(DictionaryIterator *out) {
+    StorageUsage u;
+    storage_get_usage(&u);
+    uint16_t v[4] = { u.capacity, u.heap_max, u.per_card, u.record_header };
+    uint8_t b[8];
+    for (int i = 0; i < 4; i++) {
+        b[2 * i] = (uint8_t)v[i];
+        b[2 * i + 1] = (uint8_t)(v[i] >> 8);
     }
+    dict_write_data(out, MESSAGE_KEY_KEY_BUDGET, b, sizeof(b));
+    dict_write_int32(out, MESSAGE_KEY_KEY_CHUNK_MAX, s_chunk_max);
+}
 
-    Tuple *t_idx = dict_find(iter, MESSAGE_KEY_KEY_INDEX);
-    Tuple *t_len = dict_find(iter, MESSAGE_KEY_KEY_DATA_LEN);
-    Tuple *t_off = dict_find(iter, MESSAGE_KEY_KEY_DATA_OFFSET);
-    Tuple *t_data = dict_find(iter, MESSAGE_KEY_KEY_DATA);
-
-    // 2. Card header: KEY_DATA_LEN present. Records metadata + opens reassembly.
-    if (t_idx && t_len) {
-        int i = t_idx->value->int32;
-        if (i < 0 || i >= MAX_CARDS) return;
-
-        Tuple *t_name = dict_find(iter, MESSAGE_KEY_KEY_NAME);
-        Tuple *t_desc = dict_find(iter, MESSAGE_KEY_KEY_DESCRIPTION);
-        Tuple *t_fmt = dict_find(iter, MESSAGE_KEY_KEY_FORMAT);
-        Tuple *t_w = dict_find(iter, MESSAGE_KEY_KEY_WIDTH);
-        Tuple *t_h = dict_find(iter, MESSAGE_KEY_KEY_HEIGHT);
-        Tuple *t_text = dict_find(iter, MESSAGE_KEY_KEY_TEXT);
-
-        strncpy(g_cards[i].name, t_name ? t_name->value->cstring : "", MAX_NAME_LEN - 1);
-        g_cards[i].name[MAX_NAME_LEN - 1] = '\0';
-        strncpy(g_cards[i].description, t_desc ? t_desc->value->cstring : "", MAX_NAME_LEN - 1);
-        g_cards[i].description[MAX_NAME_LEN - 1] = '\0';
-        g_cards[i].format = t_fmt ? (BarcodeFormat)t_fmt->value->int32 : FORMAT_CODE128;
-        g_cards[i].width = t_w ? t_w->value->int32 : 0;
-        g_cards[i].height = t_h ? t_h->value->int32 : 0;
-
-        // Stash the raw text (rides in the header) until finalize persists it.
-        if (t_text) {
-            strncpy(s_rx_text, t_text->value->cstring, MAX_TEXT_LEN);
-            s_rx_text[MAX_TEXT_LEN] = '\0';
-            s_rx_text_len = strlen(s_rx_text);
-        } else {
-            s_rx_text[0] = '\0';
-            s_rx_text_len = 0;
+// Resume point for a delta reply: if a card was cut off mid-transfer and the
+// new manifest still needs it (same content hash, possibly a new index), keep
+// its open record under that index and return the index; else drop it, -1.
+static int resume_rx_card(const uint8_t *manifest, const uint8_t *need, int n) {
+    if (s_rx_index >= 0 && s_rx_hash != 0 && storage_card_stream_received() >= 0) {
+        for (int k = 0; k < n; k++) {
+            if (read_u32le(manifest + 4 * need[k]) == s_rx_hash) {
+                s_rx_index = need[k];
+                storage_card_stream_move(s_rx_index);
+                return s_rx_index;
+            }
         }
+    }
+    storage_card_stream_abort();
+    s_rx_index = -1;
+    s_rx_expected = 0;
+    return -1;
+}
 
-        int expected = t_len->value->int32;
-        if (expected < 0) expected = 0;
-        if (expected > MAX_BITS_LEN) expected = MAX_BITS_LEN;  // clamp to buffer
-        g_cards[i].data_len = (uint16_t)expected;
-
-        s_rx_index = i;
-        s_rx_expected = expected;
-        s_rx_received = 0;
-        memset(g_active_bits, 0, MAX_BITS_LEN);
+// Delta sync: keep every stored card the phone's manifest still lists (by
+// content hash), and reply with the indices it has to send. KEY_NEED is
+// [count, index...]; KEY_RESUME = [index, offset lo, offset hi] says a card
+// whose header and first `offset` bytes already arrived can continue from
+// there. If the reply can't be sent the phone times out and sends every card,
+// which is still correct, just slower.
+static void reply_needed_cards(const uint8_t *manifest, int len) {
+    int count = len / 4;
+    if (count > MAX_CARDS) count = MAX_CARDS;
+
+    // Heap, not stack: with 128 cards this is as big as the rest of the frame.
+    uint8_t *need = malloc(MAX_CARDS + 1);
+    if (!need) return;   // the phone times out and resends everything
+    int n = storage_apply_manifest(manifest, count, need + 1, MAX_CARDS);
+    if (n < 0) {
+        // Out of heap for the reconcile: fall back to a full resend.
+        storage_wipe_all_cards();
+        storage_save_count(count);
+        n = count;
+        for (int i = 0; i < count; i++) need[1 + i] = (uint8_t)i;
+    }
+    need[0] = (uint8_t)n;
+    int resume = resume_rx_card(manifest, need + 1, n < MAX_CARDS ? n : MAX_CARDS);
+    APP_LOG(APP_LOG_LEVEL_INFO, "Delta sync: %d of %d cards needed", n, count);
+    if (resume >= 0) {
+        APP_LOG(APP_LOG_LEVEL_INFO, "Resuming card %d at byte %d of %d",
+                resume, storage_card_stream_received(), s_rx_expected);
+    }
 
-        if (expected == 0) {
-            finalize_rx_card(i);  // metadata-only card (no barcode data)
+    DictionaryIterator *out;
+    if (app_message_outbox_begin(&out) == APP_MSG_OK) {
+        dict_write_data(out, MESSAGE_KEY_KEY_NEED, need, n + 1);
+        if (resume >= 0) {
+            int at = storage_card_stream_received();
+            uint8_t r[3] = { (uint8_t)resume, (uint8_t)at, (uint8_t)(at >> 8) };
+            dict_write_data(out, MESSAGE_KEY_KEY_RESUME, r, sizeof(r));
         }
+        write_sync_limits(out);
+        app_message_outbox_send();
+    }
+    free(need);
+}
+
+// Log this sync's numbers and send them to the phone as KEY_SYNC_STATS,
+// little-endian uint32s: [messages, matrix bytes, ms, cards, card ms total,
+// card ms max, gaps, dropped busy, dropped overflow, dropped other,
+// persist writes, persist bytes, persist write ms, slowest write ms].
+#define SYNC_STATS_FIELDS 14
+static void send_sync_stats(void) {
+    int ms = (int)(now_ms() - s_sync.start_ms);
+    StorageIoStats io;
+    storage_get_io_stats(&io);
+    APP_LOG(APP_LOG_LEVEL_INFO, "Sync complete: %d cards, %d data bytes in %d messages, %d ms (%d B/s)",
+            g_card_count, s_sync.bytes, s_sync.messages, ms,
+            ms > 0 ? (int)(s_sync.bytes * 1000LL / ms) : 0);
+    APP_LOG(APP_LOG_LEVEL_INFO, "Sync stats: %d cards received (max %d ms), %d gaps, "
+            "%d/%d/%d dropped, %d writes %d bytes in %d ms (max %d)",
+            s_sync.cards, s_sync.card_ms_max, s_sync.gaps, s_sync.dropped_busy,
+            s_sync.dropped_overflow, s_sync.dropped_other, (int)io.writes,
+            (int)io.bytes, (int)io.write_ms, (int)io.write_ms_max);
+
+    uint32_t v[SYNC_STATS_FIELDS] = {
+        s_sync.messages, s_sync.bytes, ms, s_sync.cards, s_sync.card_ms_total,
+        s_sync.card_ms_max, s_sync.gaps, s_sync.dropped_busy, s_sync.dropped_overflow,
+        s_sync.dropped_other, io.writes, io.bytes, io.write_ms, io.write_ms_max
+    };
+    uint8_t b[4 * SYNC_STATS_FIELDS];
+    for (int i = 0; i < SYNC_STATS_FIELDS; i++) {
+        for (int k = 0; k < 4; k++) b[4 * i + k] = (uint8_t)(v[i] >> (8 * k));
+    }
+    DictionaryIterator *out;
+    if (app_message_outbox_begin(&out) == APP_MSG_OK) {
+        dict_write_data(out, MESSAGE_KEY_KEY_SYNC_STATS, b, sizeof(b));
+        app_message_outbox_send();
+    }
+}
+
+// Sync frames (protocol v2). Cards travel as records packed into one
+// KEY_FRAMES byte array, parsed in a single pass:
+//   version (SYNC_FRAME_VERSION), then records: type u8 | len u16 | payload
+//   FRAME_CARD: index u8, format u8, codec u8, name_len u8, desc_len u8,
+//               text_len u8, width u16, height u16, data_len u16, hash u32,
+//               then name, description and raw text (no terminators)
+//   FRAME_DATA: index u8, offset u16, then matrix bytes
+// All little-endian. Unknown record types are skipped by their length.
+#define SYNC_FRAME_VERSION 2
+#define FRAME_CARD 1
+#define FRAME_DATA 2
+#define FRAME_CARD_FIXED 16
+#define FRAME_DATA_FIXED 3
+
+// Copy a length-prefixed string field into a MAX_NAME_LEN buffer.
+static void copy_field(char *out, const uint8_t *p, int len) {
+    if (len > MAX_NAME_LEN - 1) len = MAX_NAME_LEN - 1;
+    memcpy(out, p, len);
+    out[len] = '\0';
+}
+
+// FRAME_CARD: record the card's metadata and open its record in storage.
+static void rx_card_header(const uint8_t *p, int len) {
+    if (len < FRAME_CARD_FIXED) return;
+    int i = p[0];
+    int name_len = p[3], desc_len = p[4], text_len = p[5];
+    if (i >= MAX_CARDS || FRAME_CARD_FIXED + name_len + desc_len + text_len > len) return;
+
+    WalletCardInfo c;
+    memset(&c, 0, sizeof(c));
+    c.format = (BarcodeFormat)p[1];
+    c.codec = p[2];
+    c.width = read_u16le(p + 6);
+    c.height = read_u16le(p + 8);
+    c.hash = read_u32le(p + 12);
+    const uint8_t *name = p + FRAME_CARD_FIXED;
+    copy_field(c.name, name, name_len);
+    copy_field(c.description, name + name_len, desc_len);
+
+    int expected = read_u16le(p + 10);
+    if (expected > MAX_BITS_LEN) expected = MAX_BITS_LEN;
+    c.data_len = (uint16_t)expected;
+
+    // The raw text rides in the header; it goes into the record as it opens.
+    const char *text = (const char *)(name + name_len + desc_len);
+    c.text_len = (uint16_t)text_len;
+
+    if (!storage_card_stream_begin(i, &c, expected, text, text_len)) {
+        APP_LOG(APP_LOG_LEVEL_WARNING, "Card %d: %s [STORAGE FULL - not saved]", i, c.name);
+        s_rx_index = -1;
         return;
     }
+    s_rx_index = i;
+    s_rx_expected = expected;
+    s_sync.card_start_ms = now_ms();
+    s_rx_hash = c.hash;
 
-    // 3. Data chunk: KEY_DATA_OFFSET + KEY_DATA. Written at offset into staging.
-    if (t_idx && t_off && t_data) {
-        int i = t_idx->value->int32;
-        if (i != s_rx_index) return;  // header not seen / out of order — ignore
+    if (expected == 0) {
+        finalize_rx_card(i);  // metadata-only card (no barcode data)
+    }
+}
 
-        int offset = t_off->value->int32;
-        int len = (int)t_data->length;
-        if (offset < 0 || offset >= MAX_BITS_LEN) return;
-        if (offset + len > MAX_BITS_LEN) len = MAX_BITS_LEN - offset;
-        if (len <= 0) return;
+// FRAME_DATA: write the bytes from the message into the card's record.
+static void rx_card_data(const uint8_t *p, int len) {
+    if (len < FRAME_DATA_FIXED) return;
+    int i = p[0];
+    if (i != s_rx_index) return;  // header not seen / out of order — ignore
+
+    // Data arrives in increasing-offset order. One past the received prefix
+    // means one in between was lost: drop it, the resume point stays put.
+    // A duplicate (an ack retried after the watch stored it) is skipped.
+    int offset = read_u16le(p + 1);
+    int n = len - FRAME_DATA_FIXED;
+    if (!storage_card_stream_write(offset, p + FRAME_DATA_FIXED, n)) {
+        APP_LOG(APP_LOG_LEVEL_WARNING, "Card %d: chunk at %d skips %d, ignored",
+                i, offset, storage_card_stream_received());
+        s_sync.gaps++;
+        return;
+    }
+    s_sync.bytes += n;
 
-        memcpy(g_active_bits + offset, t_data->value->data, len);
-        s_rx_received += len;
+    if (storage_card_stream_received() >= s_rx_expected) {
+        finalize_rx_card(i);
+    }
+}
 
-        // Chunks arrive in increasing-offset order, so completion = the final
-        // chunk landing. Using offset (not a byte counter) is safe against a
-        // duplicated chunk from an ack that was retried after the watch already
-        // stored it — which would otherwise finalize early with a missing tail.
-        if (offset + len >= s_rx_expected) {
-            finalize_rx_card(i);
+static void rx_frames(const uint8_t *p, int len) {
+    if (len < 1 || p[0] != SYNC_FRAME_VERSION) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "Sync frame version %d not supported", len ? p[0] : -1);
+        return;
+    }
+    int at = 1;
+    while (at + 3 <= len) {
+        int type = p[at];
+        int rec_len = read_u16le(p + at + 1);
+        at += 3;
+        if (at + rec_len > len) {
+            APP_LOG(APP_LOG_LEVEL_WARNING, "Sync frame record truncated");
+            return;
         }
+        if (type == FRAME_CARD) rx_card_header(p + at, rec_len);
+        else if (type == FRAME_DATA) rx_card_data(p + at, rec_len);
+        at += rec_len;
+    }
+}
+
+static void inbox_received_handler(DictionaryIterator *iter, void *context) {
+    s_sync.messages++;
+    // 1. Sync start. With a manifest (KEY_MANIFEST: 4-byte content hash per
+    //    card) only changed cards follow; without one, start from scratch.
+    if (dict_find(iter, MESSAGE_KEY_CMD_SYNC_START)) {
+        memset(&s_sync, 0, sizeof(s_sync));
+        s_sync.start_ms = s_sync.card_start_ms = now_ms();   // a resumed card counts from here
+        s_sync.messages = 1;
+        storage_reset_io_stats();
+        code_cache_drop();
+        s_demo_cards = false;
+        Tuple *t_manifest = dict_find(iter, MESSAGE_KEY_KEY_MANIFEST);
+        if (t_manifest) {
+            reply_needed_cards(t_manifest->value->data, t_manifest->length);
+        } else {
+            g_card_count = 0;
+            storage_save_count(0);
+            storage_wipe_all_cards();  // free orphaned data from a previous larger sync
+            s_rx_index = -1;
+            s_rx_expected = 0;
+        }
+        s_loading = false;
+        menu_layer_reload_data(s_menu_layer);
         return;
     }
 
-    // 4. Sync complete
+    // 2. Card headers and data: records packed into KEY_FRAMES. The last
+    //    message of a sync may carry CMD_SYNC_COMPLETE too.
+    Tuple *t_frames = dict_find(iter, MESSAGE_KEY_KEY_FRAMES);
+    if (t_frames) {
+        rx_frames(t_frames->value->data, t_frames->length);
+    }
+
+    // 3. Sync complete
     if (dict_find(iter, MESSAGE_KEY_CMD_SYNC_COMPLETE)) {
-        APP_LOG(APP_LOG_LEVEL_INFO, "Sync complete: %d cards", g_card_count);
-        // If the detail view is open, its data may have just been overwritten by
-        // the sync — reload it now that the shared staging buffer is free again.
+        send_sync_stats();
+        // Cards sent in this sync already refreshed the detail view as they
+        // landed; a card the delta only moved or removed shows up here.
         if (s_barcode_layer && window_stack_get_top_window() == s_detail_window) {
             if (s_current_index >= g_card_count) s_current_index = 0;
-            load_current_card_data();
-            layer_mark_dirty(s_barcode_layer);
+            const WalletCardInfo *c = card_info(s_current_index);
+            if (!c || c->hash != s_card.hash) {
+                load_current_card_data();
+                layer_mark_dirty(s_barcode_layer);
+            }
         }
         return;
     }
 
-    // 5. Config updated notification (legacy)
+    // 4. Config updated notification (legacy)
     if (dict_find(iter, MESSAGE_KEY_CONFIG_UPDATED)) {
         request_cards_from_phone(NULL);
     }
@@ -224,6 +500,9 @@ static void inbox_received_handler(DictionaryIterator *iter, void *context) {
 
 static void inbox_dropped_callback(AppMessageResult reason, void *context) {
     APP_LOG(APP_LOG_LEVEL_ERROR, "Message dropped: %d", (int)reason);
+    if (reason == APP_MSG_BUSY) s_sync.dropped_busy++;
+    else if (reason == APP_MSG_BUFFER_OVERFLOW) s_sync.dropped_overflow++;
+    else s_sync.dropped_other++;
 }
 
 static void outbox_failed_callback(DictionaryIterator *iterator, AppMessageResult reason, void *context) {
@@ -234,9 +513,6 @@ static void outbox_failed_callback(DictionaryIterator *iterator, AppMessageResul
 // Detail Window (Barcode Display)
 // ============================================================================
 
-#define DETAIL_NAME_H 22   // top strip showing the card name
-#define TEXT_VIEW_FONT FONT_KEY_GOTHIC_24_BOLD
-
 // Text-view content box (width available for wrapping the raw text).
 static GRect text_content_box(GRect bounds) {
     return GRect(bounds.origin.x + 4, 0, bounds.size.w - 8, 2000);
@@ -268,8 +544,6 @@ static void barcode_update_proc(Layer *layer, GContext *ctx) {
     graphics_fill_rect(ctx, bounds, 0, GCornerNone);
 
     if (s_current_index >= 0 && s_current_index < g_card_count) {
-        WalletCardInfo *info = &g_cards[s_current_index];
-
         if (s_text_mode) {
             // Raw human-readable code, wrapped and scrolled. Drawn first so the
             // name strip below can mask anything that scrolls up under it.
@@ -280,10 +554,14 @@ static void barcode_update_proc(Layer *layer, GContext *ctx) {
             graphics_draw_text(ctx, txt, fonts_get_system_font(TEXT_VIEW_FONT), tb,
                 GTextOverflowModeWordWrap, GTextAlignmentCenter, NULL);
         } else {
-            GRect code_bounds = GRect(bounds.origin.x, bounds.origin.y + DETAIL_NAME_H,
-                                      bounds.size.w, bounds.size.h - DETAIL_NAME_H);
-            barcode_draw(ctx, code_bounds, info->format,
-                         info->width, info->height, g_active_bits);
+            GRect code_bounds = detail_code_bounds(bounds);
+            code_cache_build(code_bounds.size);
+            if (s_code_cache) {
+                graphics_draw_bitmap_in_rect(ctx, s_code_cache, code_bounds);
+            } else {
+                barcode_draw(ctx, code_bounds, s_card.format,
+                             s_active_width, s_active_height, g_active_bits);
+            }
         }
 
         // Name strip on top (so you can tell which card you're on while cycling,
@@ -292,7 +570,7 @@ static void barcode_update_proc(Layer *layer, GContext *ctx) {
         graphics_fill_rect(ctx, GRect(bounds.origin.x, bounds.origin.y,
                            bounds.size.w, DETAIL_NAME_H), 0, GCornerNone);
         graphics_context_set_text_color(ctx, GColorBlack);
-        graphics_draw_text(ctx, info->name,
+        graphics_draw_text(ctx, s_card.name,
             fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD),
             GRect(bounds.origin.x + 2, bounds.origin.y - 1, bounds.size.w - 4, DETAIL_NAME_H),
             GTextOverflowModeTrailingEllipsis, GTextAlignmentCenter, NULL);
@@ -301,24 +579,54 @@ static void barcode_update_proc(Layer *layer, GContext *ctx) {
 }
 
 static void load_current_card_data(void) {
+    code_cache_drop();
     s_detail_text[0] = '\0';
     s_text_scroll = 0;
+    s_active_width = 0;
+    s_active_height = 0;
+    // Check the stored record first: a damaged one reverts to its previous
+    // version (changing the info) or is dropped, and then only it is resent.
+    if (!s_demo_cards && s_current_index >= 0 && s_current_index < g_card_count &&
+        !storage_verify_card(s_current_index)) {
+        request_cards_from_phone(NULL);
+    }
+    const WalletCardInfo *info = card_info(s_current_index);
+    if (info) {
+        s_card = *info;
+    } else {
+        memset(&s_card, 0, sizeof(s_card));   // not synced yet: "No Data"
+    }
     if (s_current_index >= 0 && s_current_index < g_card_count) {
-        // Clear first: g_active_bits is shared with the sync reassembly buffer,
-        // so wipe any stale bytes before loading this card.
+        // Clear first so a shorter matrix doesn't inherit the last one's tail.
         memset(g_active_bits, 0, MAX_BITS_LEN);
 
-        // Demo cards carry no pre-rendered pixel data (width==0, data_len==0);
-        // stage their raw text so the on-watch fallback renderer can draw them.
-        WalletCardInfo *c = &g_cards[s_current_index];
-        if (c->width == 0 && c->height == 0 && c->data_len == 0) {
-            load_demo_data(s_current_index);
-            strncpy(s_detail_text, (const char *)g_active_bits, MAX_TEXT_LEN);
-            s_detail_text[MAX_TEXT_LEN] = '\0';
+        const WalletCardInfo *c = &s_card;
+        if (s_demo_cards) {
+            load_demo_text(s_current_index, s_detail_text, sizeof(s_detail_text));
         } else {
-            storage_load_card_data(s_current_index, g_active_bits, MAX_BITS_LEN);
             storage_load_card_text(s_current_index, s_detail_text, sizeof(s_detail_text));
         }
+
+        if (c->width > 0 && c->height > 0) {
+            if (storage_load_card_data(s_current_index, g_active_bits, MAX_BITS_LEN)) {
+                s_active_width = c->width;
+                s_active_height = c->height;
+            }
+        } else {
+            // Text-only card (demo, or one the phone didn't pre-render): encode
+            // it once here so every redraw takes the pre-rendered path. If it
+            // can't be encoded, keep the text so the renderer can say why.
+            if (!barcode_encode_text(c->format, s_detail_text, g_active_bits, MAX_BITS_LEN,
+                                     &s_active_width, &s_active_height)) {
+                strncpy((char *)g_active_bits, s_detail_text, MAX_BITS_LEN - 1);
+            }
+        }
+
+        // Render the code once now; redraws then just blit the cached bitmap.
+        // The detail layer is full-window, so the main window gives its size
+        // even before the detail window is first pushed.
+        Layer *root = s_barcode_layer ? s_barcode_layer : window_get_root_layer(s_main_window);
+        code_cache_build(detail_code_bounds(layer_get_bounds(root)).size);
     }
 }
 
@@ -396,6 +704,7 @@ static void detail_window_load(Window *window) {
 static void detail_window_unload(Window *window) {
     // Safety net: never leave the backlight forced on after the window closes.
     if (s_backlight_on) { light_enable(false); s_backlight_on = false; }
+    code_cache_drop();   // give the heap back while the list is showing
     layer_destroy(s_barcode_layer);
     s_barcode_layer = NULL;
 }
@@ -449,7 +758,12 @@ static void menu_draw_row(GContext *ctx, const Layer *cell_layer, MenuIndex *cel
         return;
     }
 
-    WalletCardInfo *c = &g_cards[cell_index->row];
+    // Rows are paged in as the menu scrolls; only the visible ones are read.
+    const WalletCardInfo *c = card_info(cell_index->row);
+    if (!c) {
+        menu_cell_basic_draw(ctx, cell_layer, "Waiting for sync", NULL, NULL);
+        return;
+    }
 
     // Draw card name
     graphics_draw_text(ctx, c->name,
@@ -464,10 +778,11 @@ static void menu_draw_row(GContext *ctx, const Layer *cell_layer, MenuIndex *cel
         subtitle = c->description;
     } else {
         static const char *fmt_names[] = {
-            "Code 128", "Code 39", "EAN-13", "QR Code", "Aztec", "PDF417"
+            "Code 128", "Code 39", "EAN-13", "QR Code", "Aztec", "PDF417",
+            "EAN-8", "UPC-A", "ITF"
         };
         int fi = (int)c->format;
-        if (fi >= 0 && fi <= 5) {
+        if (fi >= 0 && fi < (int)(sizeof(fmt_names) / sizeof(fmt_names[0]))) {
             snprintf(fmt_subtitle, sizeof(fmt_subtitle), "%s", fmt_names[fi]);
         } else {
             snprintf(fmt_subtitle, sizeof(fmt_subtitle), "Barcode");
@@ -514,6 +829,7 @@ static void request_cards_from_phone(void *data) {
     AppMessageResult result = app_message_outbox_begin(&iter);
     if (result == APP_MSG_OK) {
         dict_write_uint8(iter, MESSAGE_KEY_REQUEST_CARDS, 1);
+        write_sync_limits(iter);
         app_message_outbox_send();
     }
 }
@@ -543,7 +859,11 @@ static void init(void) {
     app_message_register_inbox_received(inbox_received_handler);
     app_message_register_inbox_dropped(inbox_dropped_callback);
     app_message_register_outbox_failed(outbox_failed_callback);
-    app_message_open(2048, 256);
+    uint32_t inbox = app_message_inbox_size_maximum();
+    if (inbox > SYNC_INBOX_MAX) inbox = SYNC_INBOX_MAX;
+    app_message_open(inbox, 256);
+    // A sync message is KEY_FRAMES, plus CMD_SYNC_COMPLETE on the last one.
+    s_chunk_max = (int)inbox - (int)dict_calc_buffer_size(2, sizeof(int32_t), 0);
 
     // Create main window
     s_main_window = window_create();
@@ -563,13 +883,13 @@ static void init(void) {
         }
     }
 
-    // Only pull from the phone when nothing is persisted. The config page syncs
-    // on close, so stored cards are already current; re-syncing on every launch
-    // would blank/flicker the card we just opened (g_active_bits is the shared
-    // sync-staging buffer). A fresh install (or a storage-schema wipe) has 0
-    // cards, requests them, and falls back to demo cards if the phone is silent.
-    if (g_card_count == 0) {
-        app_timer_register(500, request_cards_from_phone, NULL);
+    // Delta-sync on every launch: the manifest exchange costs a few bytes when
+    // nothing changed, and incoming cards stream into storage without touching
+    // the card on screen. A fresh install (or a storage-schema wipe) has 0
+    // cards and falls back to demo cards if the phone is silent; so does a
+    // sync cut off before every listed card arrived.
+    app_timer_register(500, request_cards_from_phone, NULL);
+    if (g_card_count == 0 || storage_has_missing_cards()) {
         app_timer_register(3000, loading_timeout, NULL);
     }
 }
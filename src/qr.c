@@ -2,14 +2,22 @@
 #include <string.h>
 
 // ============================================================================
-// QR Code Generator - On-watch, alphanumeric mode, versions 1-4, EC level L
-// Static memory allocation (safe for Aplite's limited RAM)
+// QR Code Generator - On-watch, numeric/alphanumeric/byte mode, versions 1-10,
+// EC levels L/M/Q/H with block interleaving, best of 8 masks by penalty score.
+// The symbol lives in two bit planes, one 64-bit word per row (57 <= 64):
+// module colours, and which modules are reserved for function patterns.
+// Masking, reserved tests and penalty scoring work on whole row words.
+// Static memory allocation (safe for Aplite's limited RAM): ~0.9 KB.
 // ============================================================================
 
-#define QR_MAX_SIZE 33
+#define QR_MAX_VERSION 10
+#define QR_MAX_SIZE (17 + 4 * QR_MAX_VERSION)   // 57
+#define QR_MAX_EC_PER_BLOCK 30
 
-// Static matrix in BSS segment (not stack) - saves ~1KB stack
-static int8_t s_qr_matrix[QR_MAX_SIZE][QR_MAX_SIZE];
+// Bit c of row r = module (r, c); 1 = dark / reserved.
+static uint64_t s_modules[QR_MAX_SIZE];
+static uint64_t s_reserved[QR_MAX_SIZE];
+static uint8_t s_rs_log[QR_MAX_EC_PER_BLOCK];   // generator, log form
 
 // --- Lookup Tables (ROM) ---
 
@@ -52,18 +60,57 @@ static const uint8_t GF_LOG[256] = {
     79,174,213,233,230,231,173,232,116,214,244,234,168,80,88,175
 };
 
-// Reed-Solomon generator polynomials (GF element values, NOT exponents)
-static const uint8_t RS_GEN_V1[] = {1, 127, 122, 154, 164, 11, 68, 117};
-static const uint8_t RS_GEN_V2[] = {1, 216, 194, 159, 111, 199, 94, 95, 113, 157, 193};
-static const uint8_t RS_GEN_V3[] = {1, 29, 196, 111, 163, 112, 74, 10, 105, 105, 139, 132, 151, 32, 134, 26};
-static const uint8_t RS_GEN_V4[] = {1, 152, 185, 240, 5, 111, 99, 6, 220, 112, 150, 69, 36, 187, 22, 228, 198, 121, 121, 165, 174};
-static const uint8_t *RS_GENERATORS[] = {RS_GEN_V1, RS_GEN_V2, RS_GEN_V3, RS_GEN_V4};
+// Per version (index 0 unused): total codewords (data + EC) in the symbol.
+static const uint16_t RAW_CODEWORDS[QR_MAX_VERSION + 1] = {
+    0, 26, 44, 70, 100, 134, 172, 196, 242, 292, 346
+};
+
+// Per EC level and version: EC codewords per block, and number of blocks.
+static const uint8_t EC_PER_BLOCK[4][QR_MAX_VERSION + 1] = {
+    {0,  7, 10, 15, 20, 26, 18, 20, 24, 30, 18},   // L
+    {0, 10, 16, 26, 18, 24, 16, 18, 22, 22, 26},   // M
+    {0, 13, 22, 18, 26, 18, 24, 18, 22, 20, 24},   // Q
+    {0, 17, 28, 22, 16, 22, 28, 26, 26, 24, 28},   // H
+};
+static const uint8_t NUM_BLOCKS[4][QR_MAX_VERSION + 1] = {
+    {0, 1, 1, 1, 1, 1, 2, 2, 2, 2, 4},
+    {0, 1, 1, 1, 2, 2, 4, 4, 4, 5, 5},
+    {0, 1, 1, 2, 2, 4, 4, 6, 6, 8, 8},
+    {0, 1, 1, 2, 4, 4, 4, 5, 6, 8, 8},
+};
+
+// --- Function Pattern Templates (ROM) ---
+// Constants ship inside the app binary, which Pebble loads into the same RAM
+// as everything else, so the templates are row bitmasks OR-ed into the planes
+// rather than whole per-version planes.
+
+// 7x7 finder, one row per byte (symmetric, so bit order doesn't matter).
+static const uint8_t FINDER_ROWS[7] = {0x7F, 0x41, 0x5D, 0x5D, 0x5D, 0x41, 0x7F};
+// 5x5 alignment pattern.
+static const uint8_t ALIGN_ROWS[5] = {0x1F, 0x11, 0x15, 0x11, 0x1F};
 
-// {size, data_cw, ec_cw, alpha_capacity}
-static const struct { uint8_t size, data_cw, ec_cw, alpha_cap; } VERSIONS[4] = {
-    {21, 19,  7,  25}, {25, 34, 10,  47}, {29, 55, 15,  77}, {33, 80, 20, 114}
+// Alignment pattern centres (besides 6), per version; 0 = none.
+static const uint8_t ALIGN_POS[QR_MAX_VERSION + 1][2] = {
+    {0, 0}, {0, 0}, {18, 0}, {22, 0}, {26, 0}, {30, 0},
+    {34, 0}, {22, 38}, {24, 42}, {26, 46}, {28, 50},
 };
 
+// 15-bit format info per EC level and mask: BCH(15,5), XOR 0x5412 applied.
+static const uint16_t FORMAT_INFO[4][8] = {
+    {0x77C4, 0x72F3, 0x7DAA, 0x789D, 0x662F, 0x6318, 0x6C41, 0x6976},   // L
+    {0x5412, 0x5125, 0x5E7C, 0x5B4B, 0x45F9, 0x40CE, 0x4F97, 0x4AA0},   // M
+    {0x355F, 0x3068, 0x3F31, 0x3A06, 0x24B4, 0x2183, 0x2EDA, 0x2BED},   // Q
+    {0x1689, 0x13BE, 0x1CE7, 0x19D0, 0x0762, 0x0255, 0x0D0C, 0x083B},   // H
+};
+
+// 18-bit version info, BCH(18,6), for versions 7-10.
+static const uint32_t VERSION_INFO[4] = {0x07C94, 0x085BC, 0x09A99, 0x0A4D3};
+
+// Mode indicators and character count widths (versions 1-9 / 10-26).
+enum { MODE_NUMERIC = 0, MODE_ALPHANUM, MODE_BYTE };
+static const uint8_t MODE_BITS[3] = {0x1, 0x2, 0x4};
+static const uint8_t COUNT_BITS[3][2] = {{10, 12}, {9, 11}, {8, 16}};
+
 // --- GF(256) Multiplication ---
 
 static uint8_t gf_mul(uint8_t a, uint8_t b) {
@@ -71,6 +118,43 @@ static uint8_t gf_mul(uint8_t a, uint8_t b) {
     return GF_EXP[(GF_LOG[a] + GF_LOG[b]) % 255];
 }
 
+// --- Reed-Solomon ---
+
+// Generator polynomial of the given degree in log form, highest coefficient
+// (always 1) dropped: s_rs_log[0] is log of the x^(degree-1) coefficient.
+// Coefficients are never zero, so the log form is always defined.
+static void rs_generator(int degree) {
+    memset(s_rs_log, 0, degree);
+    s_rs_log[degree - 1] = 1;
+    uint8_t root = 1;
+    for (int i = 0; i < degree; i++) {
+        for (int j = 0; j < degree; j++) {
+            s_rs_log[j] = gf_mul(s_rs_log[j], root);
+            if (j + 1 < degree) s_rs_log[j] ^= s_rs_log[j + 1];
+        }
+        root = gf_mul(root, 2);
+    }
+    for (int j = 0; j < degree; j++) s_rs_log[j] = GF_LOG[s_rs_log[j]];
+}
+
+// Polynomial division remainder. With the generator in log form, each
+// coefficient update is one add and one EXP lookup: no zero tests, no % 255.
+static void rs_remainder(const uint8_t *data, int len, uint8_t *ec, int degree) {
+    memset(ec, 0, degree);
+    for (int i = 0; i < len; i++) {
+        uint8_t factor = data[i] ^ ec[0];
+        memmove(ec, ec + 1, degree - 1);
+        ec[degree - 1] = 0;
+        if (factor == 0) continue;
+        int lf = GF_LOG[factor];
+        for (int j = 0; j < degree; j++) {
+            int e = lf + s_rs_log[j];
+            if (e >= 255) e -= 255;
+            ec[j] ^= GF_EXP[e];
+        }
+    }
+}
+
 // --- Bit Writing ---
 
 static void write_bits(uint8_t *buf, int *bit_pos, int value, int num_bits) {
@@ -81,178 +165,366 @@ static void write_bits(uint8_t *buf, int *bit_pos, int value, int num_bits) {
     }
 }
 
-// --- Finder Pattern ---
+// --- Segment ---
+
+// Most compact single mode that can hold all of the text.
+static int pick_mode(const uint8_t *data, int len) {
+    bool numeric = true, alnum = true;
+    for (int i = 0; i < len; i++) {
+        uint8_t c = data[i];
+        if (c < '0' || c > '9') numeric = false;
+        if (c >= 128 || ALPHANUM_MAP[c] == 255) alnum = false;
+    }
+    return numeric ? MODE_NUMERIC : alnum ? MODE_ALPHANUM : MODE_BYTE;
+}
+
+static int payload_bits(int mode, int len) {
+    switch (mode) {
+        case MODE_NUMERIC:  return 10 * (len / 3) + (len % 3 == 2 ? 7 : len % 3 == 1 ? 4 : 0);
+        case MODE_ALPHANUM: return 11 * (len / 2) + 6 * (len % 2);
+        default:            return 8 * len;
+    }
+}
 
-static void draw_finder(int r0, int c0, int size) {
-    for (int r = -1; r <= 7; r++) {
-        for (int c = -1; c <= 7; c++) {
-            if (r0 + r < 0 || r0 + r >= size || c0 + c < 0 || c0 + c >= size) continue;
-            bool outer = (r == -1 || r == 7 || c == -1 || c == 7);
-            bool border = (r == 0 || r == 6 || c == 0 || c == 6);
-            bool center = (r >= 2 && r <= 4 && c >= 2 && c <= 4);
-            s_qr_matrix[r0 + r][c0 + c] = (outer ? 0 : (border || center ? 1 : 0));
+static int data_codewords(int ver, int ecl) {
+    return RAW_CODEWORDS[ver] - EC_PER_BLOCK[ecl][ver] * NUM_BLOCKS[ecl][ver];
+}
+
+static int segment_bits(int mode, int len, int ver) {
+    int count_bits = COUNT_BITS[mode][ver >= 10];
+    if (len >= (1 << count_bits)) return -1;
+    return 4 + count_bits + payload_bits(mode, len);
+}
+
+static void encode_segment(uint8_t *buf, int *bit_pos, int mode, const uint8_t *data, int len, int ver) {
+    write_bits(buf, bit_pos, MODE_BITS[mode], 4);
+    write_bits(buf, bit_pos, len, COUNT_BITS[mode][ver >= 10]);
+    if (mode == MODE_NUMERIC) {
+        for (int i = 0; i < len; i += 3) {
+            int n = len - i < 3 ? len - i : 3;
+            int val = 0;
+            for (int k = 0; k < n; k++) val = val * 10 + (data[i + k] - '0');
+            write_bits(buf, bit_pos, val, n * 3 + 1);   // 3 digits: 10 bits, 2: 7, 1: 4
+        }
+    } else if (mode == MODE_ALPHANUM) {
+        for (int i = 0; i < len; i += 2) {
+            int val = ALPHANUM_MAP[data[i]];
+            if (i + 1 < len) {
+                val = val * 45 + ALPHANUM_MAP[data[i + 1]];
+                write_bits(buf, bit_pos, val, 11);
+            } else {
+                write_bits(buf, bit_pos, val, 6);
+            }
         }
+    } else {
+        for (int i = 0; i < len; i++) write_bits(buf, bit_pos, data[i], 8);
     }
 }
 
-// --- Public API ---
+// --- Function Patterns ---
 
-bool qr_generate_packed(const char *data, uint8_t *output_buffer, uint8_t *out_size) {
-    if (!data || !output_buffer) return false;
+static void set_module(int row, int col, bool dark) {
+    uint64_t bit = (uint64_t)1 << col;
+    s_modules[row] = dark ? (s_modules[row] | bit) : (s_modules[row] & ~bit);
+}
 
-    // Validate and select version
-    int len = strlen(data);
-    int ver_idx = -1;
-    for (int i = 0; i < 4; i++) {
-        if (len <= VERSIONS[i].alpha_cap) { ver_idx = i; break; }
+// OR a template block (one row mask per entry) into both planes at (row, col).
+static void stamp(const uint8_t *rows, int count, uint8_t reserve, int row, int col) {
+    for (int i = 0; i < count; i++) {
+        s_modules[row + i] |= (uint64_t)rows[i] << col;
+        s_reserved[row + i] |= (uint64_t)reserve << col;
     }
-    if (ver_idx < 0) return false;
+}
 
-    // Uppercase and validate characters
-    char upper[115];
-    for (int i = 0; i < len; i++) {
-        char c = data[i];
-        if (c >= 'a' && c <= 'z') c -= 32;
-        if ((uint8_t)c >= 128 || ALPHANUM_MAP[(uint8_t)c] == 255) return false;
-        upper[i] = c;
+// Format info for this EC level and mask, both copies, plus the dark module.
+// Bit i of the word, LSB = bit 0. The areas are already reserved.
+static void draw_format(int size, int ecl, int mask) {
+    int bits = FORMAT_INFO[ecl][mask];
+
+    // First copy around the top-left finder.
+    for (int i = 0; i <= 5; i++) set_module(i, 8, (bits >> i) & 1);
+    set_module(7, 8, (bits >> 6) & 1);
+    set_module(8, 8, (bits >> 7) & 1);
+    set_module(8, 7, (bits >> 8) & 1);
+    for (int i = 9; i < 15; i++) set_module(8, 14 - i, (bits >> i) & 1);
+
+    // Second copy split between the top-right and bottom-left finders.
+    for (int i = 0; i < 8; i++) set_module(8, size - 1 - i, (bits >> i) & 1);
+    for (int i = 8; i < 15; i++) set_module(size - 15 + i, 8, (bits >> i) & 1);
+    set_module(size - 8, 8, true);
+}
+
+static void draw_function_patterns(int ver, int size) {
+    memset(s_modules, 0, sizeof(s_modules));
+    memset(s_reserved, 0, sizeof(s_reserved));
+    uint64_t all = ((uint64_t)1 << size) - 1;
+
+    // Timing patterns: dark on even positions. The finder templates' light
+    // separators sit on odd positions, so OR-ing in either order is safe.
+    s_modules[6] |= 0x5555555555555555ull & all;
+    s_reserved[6] = all;
+    for (int r = 0; r < size; r += 2) s_modules[r] |= (uint64_t)1 << 6;
+    for (int r = 0; r < size; r++) s_reserved[r] |= (uint64_t)1 << 6;
+
+    // Finders; the reserved corners also cover separators and format info.
+    stamp(FINDER_ROWS, 7, 0x00, 0, 0);
+    stamp(FINDER_ROWS, 7, 0x00, 0, size - 7);
+    stamp(FINDER_ROWS, 7, 0x00, size - 7, 0);
+    for (int r = 0; r < 9; r++) s_reserved[r] |= 0x1FF | ((uint64_t)0xFF << (size - 8));
+    for (int r = size - 8; r < size; r++) s_reserved[r] |= 0x1FF;
+
+    // Alignment patterns on the grid of centres, except under the finders.
+    uint8_t pos[3] = {6, ALIGN_POS[ver][0], ALIGN_POS[ver][1]};
+    int n = ALIGN_POS[ver][0] == 0 ? 0 : ALIGN_POS[ver][1] == 0 ? 2 : 3;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            if ((i == 0 && j == 0) || (i == 0 && j == n - 1) || (i == n - 1 && j == 0)) continue;
+            stamp(ALIGN_ROWS, 5, 0x1F, pos[i] - 2, pos[j] - 2);
+        }
     }
 
-    // Create data codewords
-    uint8_t data_cw[80] = {0};
-    int bit_pos = 0;
-    write_bits(data_cw, &bit_pos, 0x2, 4);  // Mode: alphanumeric
-    write_bits(data_cw, &bit_pos, len, 9);   // Character count
-
-    for (int i = 0; i < len; i += 2) {
-        int val = ALPHANUM_MAP[(uint8_t)upper[i]];
-        if (i + 1 < len) {
-            val = val * 45 + ALPHANUM_MAP[(uint8_t)upper[i + 1]];
-            write_bits(data_cw, &bit_pos, val, 11);
-        } else {
-            write_bits(data_cw, &bit_pos, val, 6);
+    // Version info (7+): 6x3 blocks next to the top-right and bottom-left finders.
+    if (ver >= 7) {
+        uint32_t bits = VERSION_INFO[ver - 7];
+        for (int i = 0; i < 18; i++) {
+            bool dark = (bits >> i) & 1;
+            int a = size - 11 + i % 3, b = i / 3;
+            set_module(b, a, dark);
+            set_module(a, b, dark);
+            s_reserved[b] |= (uint64_t)1 << a;
+            s_reserved[a] |= (uint64_t)1 << b;
         }
     }
+}
 
-    // Terminator and padding
-    int total_bits = VERSIONS[ver_idx].data_cw * 8;
-    int term = total_bits - bit_pos;
-    if (term > 4) term = 4;
-    write_bits(data_cw, &bit_pos, 0, term);
-    if (bit_pos % 8 != 0) write_bits(data_cw, &bit_pos, 0, 8 - (bit_pos % 8));
-
-    int byte_cnt = bit_pos / 8;
-    int pad_byte = 236;
-    while (byte_cnt < VERSIONS[ver_idx].data_cw) {
-        data_cw[byte_cnt++] = pad_byte;
-        pad_byte = (pad_byte == 236) ? 17 : 236;
+// --- Codewords ---
+
+// Zigzag cursor over the non-reserved modules: two columns at a time from the
+// bottom-right, alternating up and down, skipping the vertical timing column.
+typedef struct {
+    int size, col, step, k;   // k: 0 = right column of the pair, 1 = left
+    bool up;
+} Placer;
+
+static void place_byte(Placer *p, uint8_t byte) {
+    for (int bit = 7; bit >= 0;) {
+        if (p->col < 1) return;   // symbol full
+        int r = p->up ? p->size - 1 - p->step : p->step;
+        int c = p->col - p->k;
+        if (!((s_reserved[r] >> c) & 1)) {
+            if ((byte >> bit) & 1) s_modules[r] |= (uint64_t)1 << c;
+            bit--;
+        }
+        if (++p->k == 2) {
+            p->k = 0;
+            if (++p->step == p->size) {
+                p->step = 0;
+                p->up = !p->up;
+                p->col -= 2;
+                if (p->col == 6) p->col--;
+            }
+        }
     }
+}
 
-    // Generate error correction codewords
-    uint8_t ec_cw[20] = {0};
-    int ec_len = VERSIONS[ver_idx].ec_cw;
-    for (int i = 0; i < VERSIONS[ver_idx].data_cw; i++) {
-        uint8_t factor = data_cw[i] ^ ec_cw[0];
-        memmove(ec_cw, ec_cw + 1, ec_len - 1);
-        ec_cw[ec_len - 1] = 0;
-        for (int j = 0; j < ec_len; j++)
-            ec_cw[j] ^= gf_mul(RS_GENERATORS[ver_idx][j + 1], factor);
+// `cw` holds the data codewords block after block. EC for each block goes
+// after all of the data, then everything is placed interleaved: the i-th
+// data codeword of every block, then the i-th EC codeword of every block.
+// Remainder modules after the last codeword stay light.
+static void place_codewords(uint8_t *cw, int ver, int ecl, int size) {
+    int nblocks = NUM_BLOCKS[ecl][ver];
+    int ec_len = EC_PER_BLOCK[ecl][ver];
+    int raw = RAW_CODEWORDS[ver];
+    int num_short = nblocks - raw % nblocks;
+    int short_data = raw / nblocks - ec_len;
+    int data_total = raw - ec_len * nblocks;
+
+    rs_generator(ec_len);
+    for (int b = 0, off = 0; b < nblocks; b++) {
+        int len = short_data + (b >= num_short ? 1 : 0);
+        rs_remainder(cw + off, len, cw + data_total + b * ec_len, ec_len);
+        off += len;
     }
 
-    // Build matrix
-    int size = VERSIONS[ver_idx].size;
-    memset(s_qr_matrix, -1, sizeof(s_qr_matrix));
-
-    // Finder patterns
-    draw_finder(0, 0, size);
-    draw_finder(0, size - 7, size);
-    draw_finder(size - 7, 0, size);
-
-    // Alignment pattern for V2+
-    if (ver_idx >= 1) {
-        int a = size - 7;
-        for (int r = -2; r <= 2; r++) {
-            for (int c = -2; c <= 2; c++) {
-                if (s_qr_matrix[a + r][a + c] == -1)
-                    s_qr_matrix[a + r][a + c] = (r == -2 || r == 2 || c == -2 || c == 2 || (r == 0 && c == 0)) ? 1 : 0;
-            }
+    Placer p = { size, size - 1, 0, 0, true };
+    for (int i = 0; i <= short_data; i++) {
+        for (int b = 0, off = 0; b < nblocks; b++) {
+            int len = short_data + (b >= num_short ? 1 : 0);
+            if (i < len) place_byte(&p, cw[off + i]);
+            off += len;
         }
     }
-
-    // Timing patterns
-    for (int i = 8; i < size - 8; i++) {
-        if (s_qr_matrix[6][i] == -1) s_qr_matrix[6][i] = (i % 2 == 0);
-        if (s_qr_matrix[i][6] == -1) s_qr_matrix[i][6] = (i % 2 == 0);
+    for (int i = 0; i < ec_len; i++) {
+        for (int b = 0; b < nblocks; b++) place_byte(&p, cw[data_total + b * ec_len + i]);
     }
+}
 
-    // Reserve format areas
-    for (int i = 0; i < 9; i++) {
-        if (s_qr_matrix[8][i] == -1) s_qr_matrix[8][i] = 0;
-        if (s_qr_matrix[i][8] == -1) s_qr_matrix[i][8] = 0;
+// --- Masking ---
+
+static bool mask_bit(int mask, int r, int c) {
+    switch (mask) {
+        case 0:  return (r + c) % 2 == 0;
+        case 1:  return r % 2 == 0;
+        case 2:  return c % 3 == 0;
+        case 3:  return (r + c) % 3 == 0;
+        case 4:  return (r / 2 + c / 3) % 2 == 0;
+        case 5:  return (r * c) % 2 + (r * c) % 3 == 0;
+        case 6:  return ((r * c) % 2 + (r * c) % 3) % 2 == 0;
+        default: return ((r + c) % 2 + (r * c) % 3) % 2 == 0;
     }
-    for (int i = 0; i < 8; i++) {
-        if (s_qr_matrix[8][size - 1 - i] == -1) s_qr_matrix[8][size - 1 - i] = 0;
-        if (s_qr_matrix[size - 1 - i][8] == -1) s_qr_matrix[size - 1 - i][8] = 0;
+}
+
+// XOR the mask into the data modules a row word at a time (applying it twice
+// undoes it). Every mask repeats every 6 columns, so a row's mask word is its
+// first 6 bits replicated.
+static void apply_mask(int size, int mask) {
+    uint64_t all = ((uint64_t)1 << size) - 1;
+    for (int r = 0; r < size; r++) {
+        uint64_t w = 0;
+        for (int c = 0; c < 6; c++) w |= (uint64_t)mask_bit(mask, r, c) << c;
+        w |= w << 6;
+        w |= w << 12;
+        w |= w << 24;
+        w |= w << 48;
+        s_modules[r] ^= w & all & ~s_reserved[r];
     }
-    s_qr_matrix[size - 8][8] = 1; // Dark module
-
-    // Place data bits
-    uint8_t all_cw[100];
-    memcpy(all_cw, data_cw, VERSIONS[ver_idx].data_cw);
-    memcpy(all_cw + VERSIONS[ver_idx].data_cw, ec_cw, ec_len);
-
-    int bit_idx = 0;
-    int col = size - 1;
-    bool up = true;
-    while (col >= 0) {
-        if (col == 6) col--;
-        for (int r_off = 0; r_off < size; r_off++) {
-            int r = up ? (size - 1 - r_off) : r_off;
-            for (int k = 0; k < 2; k++) {
-                int c = col - k;
-                if (c >= 0 && s_qr_matrix[r][c] == -1) {
-                    if (bit_idx < (VERSIONS[ver_idx].data_cw + ec_len) * 8) {
-                        s_qr_matrix[r][c] = (all_cw[bit_idx / 8] >> (7 - (bit_idx % 8))) & 1;
-                        bit_idx++;
-                    } else {
-                        s_qr_matrix[r][c] = 0;
-                    }
-                }
+}
+
+static int popcount64(uint64_t x) {
+    int n = 0;
+    for (; x; x &= x - 1) n++;
+    return n;
+}
+
+// 1:1:3:1:1 finder look-alike with 4 light modules on one side, as the
+// modules k = 0..10 of an 11-module window.
+static const uint16_t FINDER_LIKE[2] = {0x5D0, 0x05D};   // 10111010000, 00001011101
+
+// Penalty from word operations. Along rows, module c+k of every window is
+// the row shifted right by k; along columns, 64 columns are handled at once
+// by combining whole row words.
+static int penalty(int size) {
+    int score = 0, dark = 0;
+    uint64_t all = ((uint64_t)1 << size) - 1;
+
+    // Rows: rule 1 (runs of 5+, 3 points + 1 per extra module), rule 3.
+    for (int r = 0; r < size; r++) {
+        uint64_t m = s_modules[r];
+        dark += popcount64(m);
+        uint64_t eq = ~(m ^ (m >> 1)) & (all >> 1);          // c == c+1
+        uint64_t run5 = eq & (eq >> 1) & (eq >> 2) & (eq >> 3);   // c..c+4 equal
+        // A run of n >= 5 sets n-4 bits of run5 and scores n-2.
+        score += popcount64(run5) + 2 * popcount64(run5 & ~(run5 << 1));
+        for (int p = 0; p < 2; p++) {
+            uint64_t hit = all >> 10;
+            for (int k = 0; k < 11; k++) {
+                uint64_t s = m >> k;
+                hit &= ((FINDER_LIKE[p] >> (10 - k)) & 1) ? s : ~s;
             }
+            score += 40 * popcount64(hit);
         }
-        col -= 2;
-        up = !up;
     }
 
-    // Apply mask (pattern 0: checkerboard) and format info
-    const uint8_t FMT[] = {1,1,1,0,1,1,1,1,1,0,0,0,1,0,0};
-    for (int r = 0; r < size; r++) {
-        for (int c = 0; c < size; c++) {
-            bool reserved = (r < 9 && c < 9) || (r < 9 && c >= size - 8) || (r >= size - 8 && c < 9) || (r == 6 || c == 6);
-            if (ver_idx >= 1) {
-                int a = size - 7;
-                if (r >= a - 2 && r <= a + 2 && c >= a - 2 && c <= a + 2) reserved = true;
+    // Columns: the same rules with row words standing in for shifts.
+    uint64_t prev_run5 = 0;
+    for (int r = 0; r + 4 < size; r++) {
+        uint64_t run5 = all;
+        for (int k = 0; k < 4; k++) run5 &= ~(s_modules[r + k] ^ s_modules[r + k + 1]);
+        score += popcount64(run5) + 2 * popcount64(run5 & ~prev_run5);
+        prev_run5 = run5;
+    }
+    for (int r = 0; r + 10 < size; r++) {
+        for (int p = 0; p < 2; p++) {
+            uint64_t hit = all;
+            for (int k = 0; k < 11; k++) {
+                uint64_t s = s_modules[r + k];
+                hit &= ((FINDER_LIKE[p] >> (10 - k)) & 1) ? s : ~s;
             }
-            if (!reserved && (r + c) % 2 == 0) s_qr_matrix[r][c] ^= 1;
+            score += 40 * popcount64(hit);
         }
     }
 
-    // Write format bits
-    for (int i = 0; i < 6; i++) s_qr_matrix[8][i] = FMT[i];
-    s_qr_matrix[8][7] = FMT[6]; s_qr_matrix[8][8] = FMT[7]; s_qr_matrix[7][8] = FMT[8];
-    for (int i = 9; i < 15; i++) s_qr_matrix[14 - i][8] = FMT[i];
-    for (int i = 0; i < 7; i++) s_qr_matrix[size - 1 - i][8] = FMT[i];
-    for (int i = 7; i < 15; i++) s_qr_matrix[8][size - 15 + i] = FMT[i];
+    // Rule 2: 2x2 blocks of one colour.
+    for (int r = 0; r + 1 < size; r++) {
+        uint64_t v = ~(s_modules[r] ^ s_modules[r + 1]);           // vertical pairs
+        uint64_t h = ~(s_modules[r] ^ (s_modules[r] >> 1));       // horizontal pairs
+        score += 3 * popcount64(v & (v >> 1) & h & (all >> 1));
+    }
 
-    // Pack output
-    *out_size = size;
+    // Rule 4: 10 points per 5% the dark share deviates from 50%.
+    int total = size * size;
+    int dev = dark * 20 - total * 10;
+    if (dev < 0) dev = -dev;
+    score += ((dev + total - 1) / total - 1) * 10;
+    return score;
+}
+
+// --- Public API ---
+
+// Encodes `data` in the smallest version (1-10) that fits at `min_ec`, then
+// raises the EC level as far as that version allows. Output is the usual
+// MSB-first packed matrix; `out_len` must hold (size * size + 7) / 8 bytes.
+// The output buffer doubles as codeword scratch (a symbol always has more
+// modules than codeword bits), so the only static state is the two planes.
+bool qr_generate_packed(const char *data, QrEcLevel min_ec, uint8_t *output_buffer,
+                        int out_len, uint8_t *out_size) {
+    if (!data || !output_buffer) return false;
+    const uint8_t *text = (const uint8_t *)data;
+    int len = strlen(data);
+    int mode = pick_mode(text, len);
+
+    // Smallest version that fits, then the strongest EC it can carry.
+    int ver = 0, ecl = min_ec, need = 0;
+    for (int v = 1; v <= QR_MAX_VERSION; v++) {
+        need = segment_bits(mode, len, v);
+        if (need >= 0 && need <= data_codewords(v, ecl) * 8) { ver = v; break; }
+    }
+    if (ver == 0) return false;
+    while (ecl < QR_EC_H && need <= data_codewords(ver, ecl + 1) * 8) ecl++;
+
+    int size = 17 + 4 * ver;
     int total_bytes = (size * size + 7) / 8;
+    if (total_bytes > out_len) return false;
+
+    // Data codewords: segment, terminator, byte alignment, 0xEC/0x11 padding.
+    uint8_t *cw = output_buffer;
+    int data_cw = data_codewords(ver, ecl);
+    memset(cw, 0, RAW_CODEWORDS[ver]);
+    int bit_pos = 0;
+    encode_segment(cw, &bit_pos, mode, text, len, ver);
+    int term = data_cw * 8 - bit_pos;
+    if (term > 4) term = 4;
+    write_bits(cw, &bit_pos, 0, term);
+    if (bit_pos % 8 != 0) write_bits(cw, &bit_pos, 0, 8 - (bit_pos % 8));
+    uint8_t pad_byte = 0xEC;
+    for (int i = bit_pos / 8; i < data_cw; i++) {
+        cw[i] = pad_byte;
+        pad_byte ^= 0xEC ^ 0x11;
+    }
+
+    draw_function_patterns(ver, size);
+    place_codewords(cw, ver, ecl, size);
+
+    // Try all 8 masks (with their format bits) and keep the lowest penalty.
+    int best_mask = 0, best_score = 0;
+    for (int mask = 0; mask < 8; mask++) {
+        apply_mask(size, mask);
+        draw_format(size, ecl, mask);
+        int score = penalty(size);
+        if (mask == 0 || score < best_score) { best_mask = mask; best_score = score; }
+        apply_mask(size, mask);
+    }
+    apply_mask(size, best_mask);
+    draw_format(size, ecl, best_mask);
+
+    // Pack output (overwrites the codeword scratch)
+    *out_size = size;
     memset(output_buffer, 0, total_bytes);
+    int idx = 0;
     for (int r = 0; r < size; r++) {
-        for (int c = 0; c < size; c++) {
-            if (s_qr_matrix[r][c]) {
-                int idx = r * size + c;
-                output_buffer[idx / 8] |= (1 << (7 - (idx % 8)));
-            }
+        uint64_t m = s_modules[r];
+        for (int c = 0; c < size; c++, idx++) {
+            if ((m >> c) & 1) output_buffer[idx / 8] |= (1 << (7 - (idx % 8)));
         }
     }
 
@@ -1,169 +1,966 @@
 #include "common.h"
 #include <stddef.h>
+#include <string.h>
 
-// Binary storage for pre-rendered barcode data.
-// Key layout per card (16 keys):
-//   BASE + (i*16) + 0:     WalletCardInfo struct
-//   BASE + (i*16) + 1..14: Binary pixel data in 100-byte chunks
-//   BASE + (i*16) + 15:    Human-readable text (<=255 bytes, one value)
-// 14 data chunks x 100 = 1400 bytes = MAX_BITS_LEN (fits a full boarding pass).
-// NOTE: Pebble gives each app only ~4KB of persistent storage total, so the
-// phone side (pebble-js-app.js) budgets the whole card set before syncing.
+// Card storage: a packed, log-structured page store.
+// All cards live in one byte heap spread over STORAGE_PAGE_COUNT persist values
+// of STORAGE_PAGE_SIZE bytes (the per-key maximum), keys PERSIST_KEY_BASE + p.
+// Each card is one contiguous record:
+//   RecordHeader | name | description | matrix bytes (as synced) | raw text
+// with every field variable-length, so a text-only EAN card costs ~50 bytes and
+// ~75 cards fit the budget; records may straddle page boundaries. New records
+// are appended at the heap head; the directory (PERSIST_KEY_DIR header plus a
+// record table split over PERSIST_KEY_DIR_TABLE values) maps card index ->
+// record offset/length, and is the only per-card state kept in RAM (4 bytes a
+// card). Card info is paged in on demand through a small LRU (storage_card_info).
+// When the head can't fit a record, live records are slid down over the dead
+// ones (compaction) and the freed tail pages are deleted.
+// Commits are crash-safe: a save appends the new record past the head (the old
+// version stays untouched), and only the directory header write switches it
+// in. Table values are written to the spare of two banks, so an interrupted
+// commit leaves the previous directory intact. Every record carries a CRC and
+// a generation; a card that fails its CRC on open falls back to its newest
+// older version still in the heap, or is dropped so delta sync resends just it.
+// Pages are accessed through a two-frame write-back cache, so a card load is
+// usually one persist read and a sync writes each page once. The directory
+// also tracks which page keys hold data, so launch, wipe and compaction never
+// probe keys with persist_exists: their cost follows the data actually stored.
+// NOTE: Pebble gives each app only 4KB of persistent storage total. The watch
+// reports what a card set may use (storage_get_usage, sent as KEY_BUDGET) and
+// the phone (pebble-js-app.js) plans the whole set against it before syncing.
 
-#define KEYS_PER_CARD 16
-#define STORAGE_CHUNK_SIZE 100
-#define TEXT_KEY_OFFSET 15    // per-card key holding the raw text
+#define STORAGE_PAGE_SIZE PERSIST_DATA_MAX_LENGTH   // 256
+#define STORAGE_PAGE_COUNT 15
+#define STORAGE_HEAP_SIZE (STORAGE_PAGE_SIZE * STORAGE_PAGE_COUNT)   // 3840
+#define PAGE_KEY(p) (PERSIST_KEY_BASE + (p))
 
-// --- Legacy cleanup (v2.0.0 used 8 keys per card with hex compression) ---
+// Persist budget model: each key is charged its value plus the firmware's
+// settings-file record (header and key), against the app's 4KB.
+#define PERSIST_BUDGET 4096
+#define PERSIST_KEY_OVERHEAD 12
+
+// --- Legacy cleanup, run once from the schema migration ---
+// v1 kept a count at LEGACY_KEY_COUNT and hex data from LEGACY_KEY_BASE.
 #define LEGACY_KEY_COUNT 100
 #define LEGACY_KEY_BASE 1000
-#define V2_KEYS_PER_CARD 8
+// v2.0-v5 gave every card a fixed slot of up to 16 keys from PERSIST_KEY_BASE
+// and kept the bare card count (an int) in PERSIST_KEY_DIR.
+#define SLOT_KEYS_PER_CARD 16
 
 static void storage_wipe_legacy(void) {
-    // Wipe v1 legacy storage
     if (persist_exists(LEGACY_KEY_COUNT)) {
         persist_delete(LEGACY_KEY_COUNT);
-        for (int i = 0; i < 50; i++) {
-            if (persist_exists(LEGACY_KEY_BASE + i)) persist_delete(LEGACY_KEY_BASE + i);
+        for (int i = 0; i < 50; i++) persist_delete(LEGACY_KEY_BASE + i);
+    }
+}
+
+// --- Page and directory writes, counted and timed for the sync report ---
+static StorageIoStats s_io;
+
+static int io_write(uint32_t key, const void *data, int len) {
+    time_t s0, s1;
+    uint16_t ms0, ms1;
+    time_ms(&s0, &ms0);
+    int r = persist_write_data(key, data, len);
+    time_ms(&s1, &ms1);
+    uint32_t ms = (uint32_t)(s1 - s0) * 1000 + ms1 - ms0;
+    s_io.writes++;
+    if (r > 0) s_io.bytes += r;
+    s_io.write_ms += ms;
+    if (ms > s_io.write_ms_max) s_io.write_ms_max = ms;
+    return r;
+}
+
+static void io_delete(uint32_t key) {
+    persist_delete(key);
+    s_io.deletes++;
+}
+
+// ============================================================================
+// Directory
+// ============================================================================
+
+typedef struct {
+    uint16_t off;   // heap offset of the record
+    uint16_t len;   // record length in bytes, 0 = no record
+} RecordRef;
+
+typedef struct {
+    uint16_t head;               // heap bytes in use; records are packed below it
+    uint16_t count;              // number of cards
+    uint16_t live_pages;         // bit p set = page key p holds a value
+    uint8_t live_tables;         // bit k set = table key k holds a value
+    uint8_t table_bank;          // bit k = which bank holds table key k
+    uint16_t gen;                // generation of the newest record
+    uint16_t floor_gen;          // oldest generation written under the current indices
+    uint32_t crc;                // CRC-32 of this header (crc = 0) and the live table
+} DirHeader;
+
+// The record table, 64 refs per persist value; only changed values are rewritten.
+// Each value has two keys (banks): a rewrite goes to the spare bank and the old
+// one is deleted only after the header naming the new bank is committed.
+#define DIR_REFS_PER_KEY (PERSIST_DATA_MAX_LENGTH / (int)sizeof(RecordRef))
+#define DIR_TABLE_KEYS ((MAX_CARDS + DIR_REFS_PER_KEY - 1) / DIR_REFS_PER_KEY)
+#define TABLE_KEY(k, bank) (PERSIST_KEY_DIR_TABLE + (bank) * DIR_TABLE_KEYS + (k))
+
+static DirHeader s_dir;
+static RecordRef s_rec[MAX_CARDS];
+static uint8_t s_table_dirty;   // bit k = table key k changed since the last dir_write
+
+// CRC-32 (IEEE), nibble-table variant: 64 bytes of table instead of 1KB.
+static uint32_t crc32_update(uint32_t crc, const void *data, int len) {
+    static const uint32_t T[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+        0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    const uint8_t *p = data;
+    while (len-- > 0) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ T[crc & 15];
+        crc = (crc >> 4) ^ T[crc & 15];
+    }
+    return crc;
+}
+
+static uint32_t dir_crc(void) {
+    DirHeader h = s_dir;
+    h.crc = 0;
+    uint32_t crc = crc32_update(0xFFFFFFFFu, &h, sizeof(h));
+    return ~crc32_update(crc, s_rec, s_dir.count * sizeof(RecordRef));
+}
+
+static void dir_mark(int index) {
+    s_table_dirty |= 1u << (index / DIR_REFS_PER_KEY);
+}
+
+// Commit the directory. Dirty table values go to their spare bank first; the
+// header write is the commit point, after which the superseded keys are freed.
+// If a table write fails nothing is committed: the persisted header still
+// names the old, intact banks, and the tables stay dirty for the next try.
+static bool dir_write(void) {
+    bool ok = true;
+    uint8_t stale_live = 0, stale_bank = 0;   // keys to delete once committed
+    uint8_t old_bank = s_dir.table_bank, old_live = s_dir.live_tables;
+    for (int k = 0; k < DIR_TABLE_KEYS; k++) {
+        if (!(s_table_dirty & (1u << k))) continue;
+        int refs = s_dir.count - k * DIR_REFS_PER_KEY;
+        if (refs > DIR_REFS_PER_KEY) refs = DIR_REFS_PER_KEY;
+        if (s_dir.live_tables & (1u << k)) {
+            stale_live |= 1u << k;
+            stale_bank |= s_dir.table_bank & (1u << k);
+        }
+        if (refs > 0) {
+            s_dir.table_bank ^= 1u << k;
+            int bank = (s_dir.table_bank >> k) & 1;
+            if (io_write(TABLE_KEY(k, bank), &s_rec[k * DIR_REFS_PER_KEY],
+                         refs * sizeof(RecordRef)) < 0) ok = false;
+            s_dir.live_tables |= 1u << k;
+        } else {
+            s_dir.live_tables &= ~(1u << k);
         }
     }
-    // Wipe v2.0.0 storage (same base key but different struct layout)
-    // Only wipe if we detect old-format data (card info was different size)
-    // This is handled implicitly: new code reads WalletCardInfo which is smaller,
-    // and old data chunks get overwritten on first sync.
+    if (!ok) {
+        s_dir.table_bank = old_bank;
+        s_dir.live_tables = old_live;
+        return false;
+    }
+    s_table_dirty = 0;
+    s_dir.crc = dir_crc();
+    if (io_write(PERSIST_KEY_DIR, &s_dir, sizeof(s_dir)) < 0) return false;
+    for (int k = 0; k < DIR_TABLE_KEYS; k++) {
+        if (stale_live & (1u << k)) io_delete(TABLE_KEY(k, (stale_bank >> k) & 1));
+    }
+    return ok;
+}
+
+// Read the directory back; false if it is missing, torn or inconsistent.
+static bool dir_read(void) {
+    if (persist_read_data(PERSIST_KEY_DIR, &s_dir, sizeof(s_dir)) != (int)sizeof(s_dir) ||
+        s_dir.head > STORAGE_HEAP_SIZE || s_dir.count > MAX_CARDS) return false;
+    for (int k = 0; k * DIR_REFS_PER_KEY < s_dir.count; k++) {
+        int refs = s_dir.count - k * DIR_REFS_PER_KEY;
+        if (refs > DIR_REFS_PER_KEY) refs = DIR_REFS_PER_KEY;
+        int want = refs * sizeof(RecordRef);
+        if (persist_read_data(TABLE_KEY(k, (s_dir.table_bank >> k) & 1),
+                              &s_rec[k * DIR_REFS_PER_KEY], want) != want) return false;
+    }
+    return s_dir.crc == dir_crc();
+}
+
+static void dir_reset(void) {
+    memset(&s_dir, 0, sizeof(s_dir));
+    memset(s_rec, 0, sizeof(s_rec));
+    s_table_dirty = 0;
 }
 
-// --- Public API ---
+// ============================================================================
+// Records
+// ============================================================================
+
+// On-flash card header; the variable-length fields follow in this order.
+typedef struct {
+    uint8_t format;
+    uint8_t codec;
+    uint8_t name_len;
+    uint8_t desc_len;
+    uint16_t width;
+    uint16_t height;
+    uint16_t data_len;
+    uint16_t text_len;
+    uint32_t hash;
+    uint16_t gen;     // s_dir.gen when written; newer versions have higher ones
+    uint8_t index;    // card index when written
+    uint8_t reserved;
+    uint32_t crc;     // CRC-32 of the whole record, with this field 0
+} RecordHeader;
+
+static uint8_t field_len(const char *s) {
+    int n = 0;
+    while (n < MAX_NAME_LEN - 1 && s[n]) n++;
+    return (uint8_t)n;
+}
+
+static int record_len(const RecordHeader *h) {
+    return sizeof(RecordHeader) + h->name_len + h->desc_len + h->data_len + h->text_len;
+}
+
+// ============================================================================
+// Page Cache
+// ============================================================================
+
+typedef struct {
+    int16_t page;   // -1 = empty
+    bool dirty;
+    uint8_t data[STORAGE_PAGE_SIZE];
+} PageFrame;
+
+static PageFrame s_frames[2] = { { .page = -1 }, { .page = -1 } };
+static int s_frame_mru = 0;
+static int s_flash_end = 0;   // heap bytes already in flash; pages past it are fresh
+static bool s_io_ok = true;   // cleared by a failed page write
+
+static int pages_used(int head) {
+    return (head + STORAGE_PAGE_SIZE - 1) / STORAGE_PAGE_SIZE;
+}
+
+// Delete page p if the directory says it exists (no persist_exists probe).
+static void page_delete(int p) {
+    if (s_dir.live_pages & (1u << p)) {
+        io_delete(PAGE_KEY(p));
+        s_dir.live_pages &= ~(1u << p);
+    }
+}
+
+// Write a dirty frame back, trimmed to the bytes below the heap head (pages
+// past the head hold nothing and are deleted instead).
+static void frame_flush(PageFrame *f) {
+    if (f->page < 0 || !f->dirty) return;
+    int used = s_dir.head - f->page * STORAGE_PAGE_SIZE;
+    if (used > STORAGE_PAGE_SIZE) used = STORAGE_PAGE_SIZE;
+    if (used <= 0) {
+        page_delete(f->page);
+    } else if (io_write(PAGE_KEY(f->page), f->data, used) < 0) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "Storage write failed at page %d (budget full?)", f->page);
+        s_io_ok = false;
+    } else {
+        s_dir.live_pages |= 1u << f->page;   // persisted with the next dir write
+        // An eviction mid-stream puts a fresh page in flash: read it back from now on.
+        if (s_flash_end < f->page * STORAGE_PAGE_SIZE + used) {
+            s_flash_end = f->page * STORAGE_PAGE_SIZE + used;
+        }
+    }
+    f->dirty = false;
+}
+
+static void frames_flush(void) {
+    frame_flush(&s_frames[0]);
+    frame_flush(&s_frames[1]);
+    s_flash_end = s_dir.head;
+}
+
+static void frames_drop(void) {
+    s_frames[0].page = s_frames[1].page = -1;
+    s_frames[0].dirty = s_frames[1].dirty = false;
+}
+
+// Frame holding `page`, loading it (or evicting the least recently used frame)
+// as needed. Two frames let compaction copy between pages without thrashing.
+static PageFrame *frame_get(int page) {
+    for (int i = 0; i < 2; i++) {
+        if (s_frames[i].page == page) {
+            s_frame_mru = i;
+            return &s_frames[i];
+        }
+    }
+    int victim = 1 - s_frame_mru;
+    PageFrame *f = &s_frames[victim];
+    frame_flush(f);
+    memset(f->data, 0, STORAGE_PAGE_SIZE);
+    if (page * STORAGE_PAGE_SIZE < s_flash_end) {
+        persist_read_data(PAGE_KEY(page), f->data, STORAGE_PAGE_SIZE);
+    }
+    f->page = (int16_t)page;
+    f->dirty = false;
+    s_frame_mru = victim;
+    return f;
+}
+
+static void heap_read(int off, void *out, int len) {
+    uint8_t *dst = out;
+    while (len > 0) {
+        PageFrame *f = frame_get(off / STORAGE_PAGE_SIZE);
+        int at = off % STORAGE_PAGE_SIZE;
+        int n = STORAGE_PAGE_SIZE - at;
+        if (n > len) n = len;
+        memcpy(dst, f->data + at, n);
+        dst += n; off += n; len -= n;
+    }
+}
+
+static void heap_write(int off, const void *in, int len) {
+    const uint8_t *src = in;
+    while (len > 0) {
+        PageFrame *f = frame_get(off / STORAGE_PAGE_SIZE);
+        int at = off % STORAGE_PAGE_SIZE;
+        int n = STORAGE_PAGE_SIZE - at;
+        if (n > len) n = len;
+        memcpy(f->data + at, src, n);
+        f->dirty = true;
+        src += n; off += n; len -= n;
+    }
+}
+
+// Move `len` bytes down the heap (dst < src), page span by page span.
+static void heap_move_down(int dst, int src, int len) {
+    while (len > 0) {
+        int n = len;
+        if (n > STORAGE_PAGE_SIZE - src % STORAGE_PAGE_SIZE) n = STORAGE_PAGE_SIZE - src % STORAGE_PAGE_SIZE;
+        if (n > STORAGE_PAGE_SIZE - dst % STORAGE_PAGE_SIZE) n = STORAGE_PAGE_SIZE - dst % STORAGE_PAGE_SIZE;
+        PageFrame *from = frame_get(src / STORAGE_PAGE_SIZE);
+        PageFrame *to = frame_get(dst / STORAGE_PAGE_SIZE);   // never evicts `from`
+        memmove(to->data + dst % STORAGE_PAGE_SIZE, from->data + src % STORAGE_PAGE_SIZE, n);
+        to->dirty = true;
+        dst += n; src += n; len -= n;
+    }
+}
+
+// CRC-32 of heap bytes [off, off + len), streamed through the page frames.
+static uint32_t heap_crc(uint32_t crc, int off, int len) {
+    while (len > 0) {
+        PageFrame *f = frame_get(off / STORAGE_PAGE_SIZE);
+        int at = off % STORAGE_PAGE_SIZE;
+        int n = STORAGE_PAGE_SIZE - at;
+        if (n > len) n = len;
+        crc = crc32_update(crc, f->data + at, n);
+        off += n; len -= n;
+    }
+    return crc;
+}
+
+// True if a whole, undamaged record of `len` bytes starts at `off`. Fills *out
+// with its header when given.
+static bool record_check(int off, int len, RecordHeader *out) {
+    RecordHeader h;
+    if (len < (int)sizeof(h) || off + len > s_dir.head) return false;
+    heap_read(off, &h, sizeof(h));
+    if (out) *out = h;
+    if (record_len(&h) != len) return false;
+    uint32_t want = h.crc;
+    h.crc = 0;
+    uint32_t crc = crc32_update(0xFFFFFFFFu, &h, sizeof(h));
+    return ~heap_crc(crc, off + sizeof(h), len - sizeof(h)) == want;
+}
+
+// Newest intact older version of card `index` below heap offset `below`. The
+// heap is a back-to-back run of records in write order, live or dead, so one
+// walk from the start finds them; only generations written since the indices
+// were last remapped count. Returns a ref with len 0 if there is none.
+static RecordRef record_fallback(int index, int below) {
+    RecordRef best = { 0, 0 };
+    int off = 0;
+    while (off + (int)sizeof(RecordHeader) <= below) {
+        RecordHeader h;
+        heap_read(off, &h, sizeof(h));
+        int len = record_len(&h);
+        if (off + len > below) break;   // a damaged header: the chain ends here
+        if (h.index == index &&
+            (uint16_t)(h.gen - s_dir.floor_gen) <= (uint16_t)(s_dir.gen - s_dir.floor_gen) &&
+            record_check(off, len, NULL)) {
+            best.off = (uint16_t)off;
+            best.len = (uint16_t)len;
+        }
+        off += len;
+    }
+    return best;
+}
+
+// Slide every live record down over the dead space, in offset order, then
+// drop the pages the heap no longer reaches, then commit the directory. Not
+// crash-safe: page evictions persist moved records before that commit, so a
+// crash mid-compaction can damage them. Each then fails its CRC on open and
+// costs one resend (see storage_verify_card).
+static void storage_compact(void) {
+    int dst = 0;
+    for (;;) {
+        // Lowest live record at or above dst that hasn't been placed yet.
+        int next = -1;
+        for (int i = 0; i < MAX_CARDS; i++) {
+            if (s_rec[i].len == 0 || s_rec[i].off < dst) continue;
+            if (next < 0 || s_rec[i].off < s_rec[next].off) next = i;
+        }
+        if (next < 0) break;
+        RecordRef *r = &s_rec[next];
+        if (r->off != dst) heap_move_down(dst, r->off, r->len);
+        r->off = (uint16_t)dst;
+        dst += r->len;
+    }
+    s_dir.head = (uint16_t)dst;
+    s_table_dirty = (1u << DIR_TABLE_KEYS) - 1;   // offsets moved
+
+    // Rewrite the new last page trimmed, and delete pages past it.
+    int new_pages = pages_used(s_dir.head);
+    if (new_pages > 0) frame_get(new_pages - 1)->dirty = true;
+    frames_flush();
+    for (int p = new_pages; p < STORAGE_PAGE_COUNT; p++) page_delete(p);
+    frames_drop();
+    dir_write();
+    APP_LOG(APP_LOG_LEVEL_INFO, "Storage compacted to %d bytes", s_dir.head);
+}
+
+// ============================================================================
+// Budget
+// ============================================================================
+
+static int bit_count(uint32_t v) {
+    int n = 0;
+    for (; v; v &= v - 1) n++;
+    return n;
+}
+
+// Bytes every card set pays: the schema, last-index and directory-header keys,
+// plus the overhead of every page and (both banks of) every table key.
+static int budget_reserved(void) {
+    return 2 * (int)sizeof(int32_t) + (int)sizeof(DirHeader) +
+           (3 + STORAGE_PAGE_COUNT + 2 * DIR_TABLE_KEYS) * PERSIST_KEY_OVERHEAD;
+}
+
+// Record bytes plus BUDGET_PER_CARD per card a card set may use. A card costs
+// its ref in both table banks, since a commit can hold both for a moment.
+#define BUDGET_PER_CARD (2 * (int)sizeof(RecordRef))
+
+static int budget_capacity(void) {
+    return PERSIST_BUDGET - budget_reserved();
+}
+
+static int live_record_bytes(void) {
+    int n = 0;
+    for (int i = 0; i < s_dir.count; i++) n += s_rec[i].len;
+    return n;
+}
+
+// ============================================================================
+// Card Info Cache
+// The menu asks for a handful of rows at a time, so card info is read from the
+// record headers on demand and kept in a small LRU instead of a RAM array.
+// ============================================================================
+
+#define INFO_CACHE_SIZE 6
+
+typedef struct {
+    int16_t index;       // -1 = empty
+    uint16_t used;       // LRU stamp
+    uint16_t data_off;   // matrix bytes, relative to the record start
+    bool checked;        // record CRC verified
+    WalletCardInfo info;
+} InfoSlot;
+
+static InfoSlot s_info_cache[INFO_CACHE_SIZE];
+static uint16_t s_info_clock;
+
+static void info_cache_drop(int index) {
+    for (int i = 0; i < INFO_CACHE_SIZE; i++) {
+        if (index < 0 || s_info_cache[i].index == index) s_info_cache[i].index = -1;
+    }
+}
+
+static InfoSlot *info_slot(int index) {
+    if (index < 0 || index >= g_card_count || s_rec[index].len < sizeof(RecordHeader)) {
+        return NULL;
+    }
+    InfoSlot *slot = &s_info_cache[0];
+    for (int i = 0; i < INFO_CACHE_SIZE; i++) {
+        InfoSlot *s = &s_info_cache[i];
+        if (s->index == index) {
+            s->used = ++s_info_clock;
+            return s;
+        }
+        if (s->index < 0 || (slot->index >= 0 && (uint16_t)(s_info_clock - s->used) >
+                                                 (uint16_t)(s_info_clock - slot->used))) {
+            slot = s;
+        }
+    }
+
+    RecordHeader h;
+    int off = s_rec[index].off;
+    heap_read(off, &h, sizeof(h));
+    WalletCardInfo *info = &slot->info;
+    memset(info, 0, sizeof(*info));
+    int name_len = h.name_len < MAX_NAME_LEN ? h.name_len : MAX_NAME_LEN - 1;
+    int desc_len = h.desc_len < MAX_NAME_LEN ? h.desc_len : MAX_NAME_LEN - 1;
+    heap_read(off + sizeof(h), info->name, name_len);
+    heap_read(off + sizeof(h) + h.name_len, info->description, desc_len);
+    info->format = (BarcodeFormat)h.format;
+    info->codec = h.codec;
+    info->width = h.width;
+    info->height = h.height;
+    info->data_len = h.data_len;
+    info->text_len = h.text_len;
+    info->hash = h.hash;
+    slot->data_off = sizeof(h) + h.name_len + h.desc_len;
+    slot->checked = false;
+    slot->index = (int16_t)index;
+    slot->used = ++s_info_clock;
+    return slot;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+// Schema migration: wipe whatever an older version stored, touching only the
+// keys its own bookkeeping says it used. Key PERSIST_KEY_DIR held the card
+// count as an int up to v5 (fixed 16-key slots), then a page-store directory
+// starting with the heap head.
+static void storage_migrate(int schema) {
+    if (schema == 0) storage_wipe_legacy();   // pre-schema installs only
+
+    uint8_t old_dir[64];
+    int len = persist_read_data(PERSIST_KEY_DIR, old_dir, sizeof(old_dir));
+    int last_key = PERSIST_KEY_BASE;
+    if (len == (int)sizeof(int32_t)) {
+        int32_t count;
+        memcpy(&count, old_dir, sizeof(count));
+        if (count < 0 || count > 10) count = 10;   // 10 = MAX_CARDS of those versions
+        last_key += count * SLOT_KEYS_PER_CARD;
+    } else if (len >= 2) {
+        uint16_t head;
+        memcpy(&head, old_dir, sizeof(head));
+        last_key += (head > STORAGE_HEAP_SIZE) ? STORAGE_PAGE_COUNT : pages_used(head);
+    }
+    for (int key = PERSIST_KEY_BASE; key < last_key; key++) persist_delete(key);
+    if (len > 0) persist_delete(PERSIST_KEY_DIR);
+    if (schema >= 9) {   // v9 had one bank of table keys, v10 two
+        for (int k = 0; k < 2 * DIR_TABLE_KEYS; k++) persist_delete(PERSIST_KEY_DIR_TABLE + k);
+    }
+    persist_write_int(PERSIST_KEY_SCHEMA, STORAGE_SCHEMA_VERSION);
+}
 
 void storage_load_cards(void) {
-    storage_wipe_legacy();
+    storage_card_stream_abort();
+    frames_drop();
+    dir_reset();
+    info_cache_drop(-1);
+    s_flash_end = 0;
 
-    // Schema migration: the per-card key stride changed in v2.3.0 (12 -> 15),
-    // so cards written by an older version would be misread at the new offsets.
-    // If the stored schema doesn't match, wipe all card storage and start clean.
+    // The schema key doubles as the "legacy cleaned" marker: a mismatch runs
+    // the one-time migration, which wipes all card storage and starts clean.
     // No data is lost: the phone re-syncs from its own localStorage on launch.
-    int schema = persist_exists(PERSIST_KEY_SCHEMA)
-                     ? persist_read_int(PERSIST_KEY_SCHEMA) : 0;
+    int schema = persist_read_int(PERSIST_KEY_SCHEMA);   // 0 if missing
     if (schema != STORAGE_SCHEMA_VERSION) {
-        int last_key = PERSIST_KEY_BASE + (MAX_CARDS * KEYS_PER_CARD);
-        for (int key = PERSIST_KEY_BASE; key < last_key; key++) {
-            if (persist_exists(key)) persist_delete(key);
-        }
-        if (persist_exists(PERSIST_KEY_COUNT)) persist_delete(PERSIST_KEY_COUNT);
-        persist_write_int(PERSIST_KEY_SCHEMA, STORAGE_SCHEMA_VERSION);
+        storage_migrate(schema);
         g_card_count = 0;
-        APP_LOG(APP_LOG_LEVEL_INFO, "Storage migrated to schema v%d (cleared)",
-                STORAGE_SCHEMA_VERSION);
+        APP_LOG(APP_LOG_LEVEL_INFO, "Storage migrated from schema v%d to v%d (cleared)",
+                schema, STORAGE_SCHEMA_VERSION);
         return;
     }
 
-    if (!persist_exists(PERSIST_KEY_COUNT)) {
+    if (!dir_read()) {
+        // No usable directory (never written, or a torn write): clear whatever
+        // keys it may have been tracking, and let the phone resync.
+        if (persist_exists(PERSIST_KEY_DIR)) {
+            APP_LOG(APP_LOG_LEVEL_WARNING, "Storage directory damaged, cards cleared");
+            for (int p = 0; p < STORAGE_PAGE_COUNT; p++) persist_delete(PAGE_KEY(p));
+            for (int k = 0; k < 2 * DIR_TABLE_KEYS; k++) persist_delete(PERSIST_KEY_DIR_TABLE + k);
+            persist_delete(PERSIST_KEY_DIR);
+        }
+        dir_reset();
         g_card_count = 0;
         return;
     }
+    s_flash_end = s_dir.head;
+    g_card_count = s_dir.count;
+    APP_LOG(APP_LOG_LEVEL_INFO, "Loaded %d cards from storage (%d bytes)",
+            g_card_count, s_dir.head);
+}
 
-    g_card_count = persist_read_int(PERSIST_KEY_COUNT);
-    if (g_card_count > MAX_CARDS) g_card_count = MAX_CARDS;
+// Info for card `index`, paged in from its record header, or NULL if it has
+// no record (not synced yet). The pointer stays valid until the next call:
+// copy what has to outlive it.
+const WalletCardInfo *storage_card_info(int index) {
+    InfoSlot *slot = info_slot(index);
+    return slot ? &slot->info : NULL;
+}
 
-    for (int i = 0; i < g_card_count; i++) {
-        int base_key = PERSIST_KEY_BASE + (i * KEYS_PER_CARD);
-        persist_read_data(base_key, &g_cards[i], sizeof(WalletCardInfo));
-    }
-    APP_LOG(APP_LOG_LEVEL_INFO, "Loaded %d cards from storage", g_card_count);
-}
-
-void storage_load_card_data(int index, uint8_t *buffer, int max_len) {
-    if (!buffer || index < 0 || index >= g_card_count) return;
-    int base_key = PERSIST_KEY_BASE + (index * KEYS_PER_CARD);
-
-    int total_read = 0;
-    // Matrix data lives in chunk keys 1..14 (stop before the text key at 15).
-    for (int k = 1; k < TEXT_KEY_OFFSET; k++) {
-        int chunk_key = base_key + k;
-        if (persist_exists(chunk_key) && total_read < max_len) {
-            // Never let a 100-byte chunk write past the caller's buffer.
-            int want = max_len - total_read;
-            if (want > STORAGE_CHUNK_SIZE) want = STORAGE_CHUNK_SIZE;
-            int read = persist_read_data(chunk_key, buffer + total_read, want);
-            if (read <= 0) break;
-            total_read += read;
-        } else {
-            break;
-        }
+// Check card `index`'s record against its CRC (once per cache residency). A
+// damaged record is replaced by the newest intact older version of the card
+// still in the heap, or else dropped, so the next delta sync resends only it.
+// False if the card has no usable record. Call before storage_card_info() when
+// opening a card: a fallback can change its info.
+bool storage_verify_card(int index) {
+    InfoSlot *slot = info_slot(index);
+    if (!slot) return false;
+    if (slot->checked) return true;
+    RecordRef *r = &s_rec[index];
+    if (record_check(r->off, r->len, NULL)) {
+        slot->checked = true;
+        return true;
     }
+
+    RecordRef good = record_fallback(index, r->off);
+    APP_LOG(APP_LOG_LEVEL_WARNING, "Card %d: record at %d fails its CRC, %s", index, r->off,
+            good.len ? "reverted to the previous version" : "dropped for resync");
+    info_cache_drop(index);
+    *r = good;
+    dir_mark(index);
+    dir_write();
+    slot = info_slot(index);
+    if (slot) slot->checked = true;
+    return slot != NULL;
+}
+
+// Load the card's matrix into buffer, unpacked. False if nothing usable was
+// stored (no record, failed CRC, corrupt packed data).
+bool storage_load_card_data(int index, uint8_t *buffer, int max_len) {
+    if (!buffer || !storage_verify_card(index)) return false;
+    InfoSlot *slot = info_slot(index);
+    if (!slot || slot->info.data_len == 0) return false;
+    WalletCardInfo info = slot->info;
+    int data_off = s_rec[index].off + slot->data_off;
+
+    if (info.codec == MATRIX_CODEC_RAW) {
+        heap_read(data_off, buffer, info.data_len < max_len ? info.data_len : max_len);
+        return true;
+    }
+
+    // Packed: stage the stored bytes on the heap only for the decode.
+    uint8_t *packed = malloc(info.data_len);
+    if (!packed) return false;
+    heap_read(data_off, packed, info.data_len);
+    bool ok = matrix_decode(info.codec, packed, info.data_len, info.width, info.height,
+                            buffer, max_len);
+    free(packed);
+    if (!ok) APP_LOG(APP_LOG_LEVEL_ERROR, "Card %d: stored matrix is corrupt", index);
+    return ok;
 }
 
 // Load the card's raw human-readable text into buffer (always null-terminated).
 void storage_load_card_text(int index, char *buffer, int max_len) {
     if (!buffer || max_len <= 0) return;
     buffer[0] = '\0';
-    if (index < 0 || index >= g_card_count) return;
-    int text_key = PERSIST_KEY_BASE + (index * KEYS_PER_CARD) + TEXT_KEY_OFFSET;
-    if (!persist_exists(text_key)) return;
-    int read = persist_read_data(text_key, buffer, max_len - 1);
-    if (read < 0) read = 0;
-    if (read > max_len - 1) read = max_len - 1;
-    buffer[read] = '\0';
+    if (!storage_verify_card(index)) return;
+    InfoSlot *slot = info_slot(index);
+    if (!slot) return;
+    int len = slot->info.text_len;
+    if (len > max_len - 1) len = max_len - 1;
+    heap_read(s_rec[index].off + slot->data_off + slot->info.data_len, buffer, len);
+    buffer[len] = '\0';
 }
 
-// Delete every persisted card slot's data (used on sync start so a shrinking
-// card set doesn't leak orphaned pixel data against the ~4KB persist budget).
+// Drop every card record and the pages holding them (used on sync start).
 void storage_wipe_all_cards(void) {
-    int last_key = PERSIST_KEY_BASE + (MAX_CARDS * KEYS_PER_CARD);
-    for (int key = PERSIST_KEY_BASE; key < last_key; key++) {
-        if (persist_exists(key)) persist_delete(key);
+    storage_card_stream_abort();
+    frames_drop();
+    info_cache_drop(-1);
+    for (int p = 0; p < STORAGE_PAGE_COUNT; p++) page_delete(p);
+    uint8_t live_tables = s_dir.live_tables, table_bank = s_dir.table_bank;
+    dir_reset();
+    s_dir.live_tables = live_tables;
+    s_dir.table_bank = table_bank;
+    s_table_dirty = (1u << DIR_TABLE_KEYS) - 1;   // count is 0: deletes the table keys
+    s_flash_end = 0;
+    dir_write();
+}
+
+// ============================================================================
+// Streaming Card Writer
+// A synced card is written straight into its record as the chunks arrive: the
+// record is reserved at the heap head up front, each chunk goes through the
+// page frames (the only receive buffer), and the commit patches in the CRC and
+// switches the directory over. Until then the persisted directory doesn't
+// reach the record, so a cut-off stream leaves the previous version in place.
+// ============================================================================
+
+static struct {
+    int16_t index;       // card being written, -1 = none
+    bool rehash;         // header changed since begin: recompute the CRC
+    uint16_t off;        // record start
+    uint16_t len;        // record length
+    uint16_t data_off;   // heap offset of the matrix bytes
+    uint16_t data_len;
+    uint16_t received;   // matrix bytes [0, received) written
+    uint16_t text_len;
+    uint32_t crc;        // running CRC of header, name, description, matrix so far
+} s_stream = { .index = -1 };
+
+// Drop an unfinished card, giving its reserved space back to the heap.
+void storage_card_stream_abort(void) {
+    if (s_stream.index < 0) return;
+    if (s_dir.head == s_stream.off + s_stream.len) {
+        s_dir.head = s_stream.off;
+        frames_flush();   // trims or deletes the pages past the head
+        for (int p = pages_used(s_dir.head); p < STORAGE_PAGE_COUNT; p++) page_delete(p);
+        frames_drop();
     }
+    s_stream.index = -1;
 }
 
-bool storage_save_card(int index, WalletCardInfo *info, const uint8_t *bits,
-                       int bits_len, const char *text, int text_len) {
+// Start writing card `index` (replacing any previous one) with `data_len`
+// matrix bytes to follow. The old version stays live until the commit, so an
+// aborted stream leaves it in place; only when the heap can't hold both is it
+// dropped up front. False, with nothing reserved, if the card can't fit.
+bool storage_card_stream_begin(int index, const WalletCardInfo *info, int data_len,
+                               const char *text, int text_len) {
+    storage_card_stream_abort();
     if (index < 0 || index >= MAX_CARDS) return false;
-    int base_key = PERSIST_KEY_BASE + (index * KEYS_PER_CARD);
-    bool ok = true;
+    if (!text || text_len < 0) text_len = 0;
+    if (text_len > MAX_TEXT_LEN) text_len = MAX_TEXT_LEN;
+    if (data_len < 0) data_len = 0;
+    if (data_len > MAX_BITS_LEN) data_len = MAX_BITS_LEN;
+    RecordHeader h = {
+        .format = (uint8_t)info->format,
+        .codec = info->codec,
+        .name_len = field_len(info->name),
+        .desc_len = field_len(info->description),
+        .width = info->width,
+        .height = info->height,
+        .data_len = (uint16_t)data_len,
+        .text_len = (uint16_t)text_len,
+        .hash = info->hash,
+        .gen = (uint16_t)(s_dir.gen + 1),
+        .index = (uint8_t)index,
+    };
+    int len = record_len(&h);
 
-    // Save card info struct
-    if (persist_write_data(base_key, info, sizeof(WalletCardInfo)) < 0) ok = false;
-
-    // Save binary matrix data in chunks (keys 1..14, before the text key).
-    int offset = 0;
-    for (int k = 1; k < TEXT_KEY_OFFSET; k++) {
-        int chunk_key = base_key + k;
-        if (offset < bits_len) {
-            int remaining = bits_len - offset;
-            int write_len = (remaining > STORAGE_CHUNK_SIZE) ? STORAGE_CHUNK_SIZE : remaining;
-            int result = persist_write_data(chunk_key, bits + offset, write_len);
-            if (result < 0) {
-                APP_LOG(APP_LOG_LEVEL_ERROR, "Storage write failed at chunk %d (budget full?)", k);
-                ok = false;
-            }
-            offset += write_len;
-        } else {
-            if (persist_exists(chunk_key)) persist_delete(chunk_key);
+    // Budgeted as if committed: the old version is dead space by then.
+    int count = index >= s_dir.count ? index + 1 : s_dir.count;
+    int room = budget_capacity() - (live_record_bytes() - s_rec[index].len) -
+               BUDGET_PER_CARD * count;
+    if (len > room) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "Card %d (%d bytes) is over the persist budget (%d free)",
+                index, len, room);
+        return false;
+    }
+    if (s_dir.head + len > STORAGE_HEAP_SIZE) {
+        if (live_record_bytes() + len > STORAGE_HEAP_SIZE && s_rec[index].len) {
+            info_cache_drop(index);
+            s_rec[index].len = 0;   // no room for both: the old version goes now
+            dir_mark(index);
         }
+        storage_compact();
     }
+    if (s_dir.head + len > STORAGE_HEAP_SIZE) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "Card %d (%d bytes) doesn't fit: %d of %d bytes used",
+                index, len, s_dir.head, STORAGE_HEAP_SIZE);
+        return false;
+    }
+
+    int off = s_dir.head;
+    s_dir.head += len;
+    s_dir.gen = h.gen;
+    s_io_ok = true;
+    s_stream.index = (int16_t)index;
+    s_stream.rehash = false;
+    s_stream.off = (uint16_t)off;
+    s_stream.len = (uint16_t)len;
+    s_stream.data_off = (uint16_t)(off + sizeof(h) + h.name_len + h.desc_len);
+    s_stream.data_len = h.data_len;
+    s_stream.received = 0;
+    s_stream.text_len = h.text_len;
 
-    // Save the raw text in its own key (key 15), or clear it if empty.
-    int text_key = base_key + TEXT_KEY_OFFSET;
-    if (text && text_len > 0) {
-        if (text_len > MAX_TEXT_LEN) text_len = MAX_TEXT_LEN;
-        if (persist_write_data(text_key, text, text_len) < 0) ok = false;
+    // Header (CRC still 0), name, description and text now; the matrix fills
+    // the gap before the text as it arrives.
+    heap_write(off, &h, sizeof(h));
+    heap_write(off + sizeof(h), info->name, h.name_len);
+    heap_write(off + sizeof(h) + h.name_len, info->description, h.desc_len);
+    heap_write(s_stream.data_off + data_len, text, text_len);
+    uint32_t crc = crc32_update(0xFFFFFFFFu, &h, sizeof(h));
+    crc = crc32_update(crc, info->name, h.name_len);
+    s_stream.crc = crc32_update(crc, info->description, h.desc_len);
+    return true;
+}
+
+// Write matrix bytes [offset, offset + len) of the card being streamed, in
+// order: bytes already written are skipped (a resent chunk), and a chunk past
+// storage_card_stream_received() (one lost in between) is refused.
+bool storage_card_stream_write(int offset, const uint8_t *data, int len) {
+    if (s_stream.index < 0 || offset < 0 || offset > s_stream.received) return false;
+    int skip = s_stream.received - offset;
+    if (len <= skip) return true;
+    data += skip;
+    len -= skip;
+    if (len > s_stream.data_len - s_stream.received) len = s_stream.data_len - s_stream.received;
+    heap_write(s_stream.data_off + s_stream.received, data, len);
+    s_stream.crc = crc32_update(s_stream.crc, data, len);
+    s_stream.received += len;
+    return true;
+}
+
+// Matrix bytes of the streamed card written so far, -1 if none is open.
+int storage_card_stream_received(void) {
+    return s_stream.index < 0 ? -1 : s_stream.received;
+}
+
+// Re-target the card being streamed (a resumed sync remapped it).
+void storage_card_stream_move(int index) {
+    if (s_stream.index < 0 || index == s_stream.index || index < 0 || index >= MAX_CARDS) return;
+    uint8_t b = (uint8_t)index;
+    heap_write(s_stream.off + offsetof(RecordHeader, index), &b, 1);
+    s_stream.index = (int16_t)index;
+    s_stream.rehash = true;
+}
+
+// Finish the card once every matrix byte is in: seal the CRC, flush the pages
+// and commit the directory. False if it is incomplete or a write failed.
+bool storage_card_stream_commit(void) {
+    if (s_stream.index < 0) return false;
+    if (s_stream.received < s_stream.data_len) {
+        storage_card_stream_abort();
+        return false;
+    }
+    int index = s_stream.index;
+    uint32_t crc;
+    if (s_stream.rehash) {
+        RecordHeader h;
+        heap_read(s_stream.off, &h, sizeof(h));
+        crc = heap_crc(crc32_update(0xFFFFFFFFu, &h, sizeof(h)), s_stream.off + sizeof(h),
+                       s_stream.len - sizeof(h));
     } else {
-        if (persist_exists(text_key)) persist_delete(text_key);
+        crc = heap_crc(s_stream.crc, s_stream.data_off + s_stream.data_len, s_stream.text_len);
     }
-    return ok;
+    crc = ~crc;
+    heap_write(s_stream.off + offsetof(RecordHeader, crc), &crc, sizeof(crc));
+    frames_flush();
+    if (index >= s_dir.count) s_dir.count = (uint16_t)(index + 1);
+    s_rec[index].off = s_stream.off;
+    s_rec[index].len = s_stream.len;
+    dir_mark(index);
+    info_cache_drop(index);
+    s_stream.index = -1;
+    return dir_write() && s_io_ok;
 }
 
-// Remember the last-viewed card so the app can open straight to it next launch.
-void storage_save_last_index(int index) {
-    persist_write_int(PERSIST_KEY_LAST, index);
+// Save a whole card at once: the streaming writer in one go.
+bool storage_save_card(int index, const WalletCardInfo *info, const uint8_t *bits,
+                       int bits_len, const char *text, int text_len) {
+    if (!bits || bits_len < 0) bits_len = 0;
+    if (!storage_card_stream_begin(index, info, bits_len, text, text_len)) return false;
+    storage_card_stream_write(0, bits, bits_len);
+    return storage_card_stream_commit();
 }
 
-int storage_load_last_index(void) {
-    return persist_exists(PERSIST_KEY_LAST) ? persist_read_int(PERSIST_KEY_LAST) : 0;
+void storage_save_count(int count) {
+    if (count > MAX_CARDS) count = MAX_CARDS;
+    g_card_count = count;
+    if (s_dir.count == count) return;   // storage_save_card already extended it
+    for (int i = count; i < s_dir.count; i++) s_rec[i].len = 0;
+    s_table_dirty = (1u << DIR_TABLE_KEYS) - 1;
+    s_dir.floor_gen = (uint16_t)(s_dir.gen + 1);   // dropped indices may be reused
+    info_cache_drop(-1);
+    s_dir.count = (uint16_t)count;
+    dir_write();
 }
 
-void storage_save_count(int count) {
+// Delta sync: reconcile the stored cards with the phone's manifest (one 4-byte
+// little-endian content hash per card, in the new order). A card whose hash is already stored keeps
+// its record -- moved to its new index if the list was reordered, without
+// touching the pages -- and everything else becomes dead space for compaction.
+// A stored record that fails its CRC never matches, so the phone resends it.
+// Writes the indices the phone still has to send into need[] and returns how
+// many there are (-1 if out of memory).
+int storage_apply_manifest(const uint8_t *manifest, int count, uint8_t *need, int need_max) {
+    if (count < 0) count = 0;
     if (count > MAX_CARDS) count = MAX_CARDS;
+    int old_count = s_dir.count;
+    RecordRef *old_rec = malloc(sizeof(RecordRef) * (old_count + 1));
+    uint32_t *old_hash = malloc(sizeof(uint32_t) * (old_count + 1));
+    if (!old_rec || !old_hash) {
+        free(old_rec);
+        free(old_hash);
+        return -1;
+    }
+    memcpy(old_rec, s_rec, sizeof(RecordRef) * old_count);
+    for (int j = 0; j < old_count; j++) {
+        old_hash[j] = 0;
+        RecordHeader h;
+        if (record_check(old_rec[j].off, old_rec[j].len, &h)) old_hash[j] = h.hash;
+    }
+
+    int needed = 0;
+    memset(s_rec, 0, sizeof(s_rec));
+    for (int i = 0; i < count; i++) {
+        const uint8_t *m = manifest + 4 * i;
+        uint32_t hash = (uint32_t)m[0] | ((uint32_t)m[1] << 8) | ((uint32_t)m[2] << 16) |
+                        ((uint32_t)m[3] << 24);
+        int match = -1;
+        for (int j = 0; j < old_count && match < 0; j++) {
+            if (hash != 0 && old_hash[j] == hash) match = j;
+        }
+        if (match >= 0) {
+            old_hash[match] = 0;   // each stored record is claimed once
+            s_rec[i] = old_rec[match];
+        } else {
+            if (needed < need_max) need[needed] = (uint8_t)i;
+            needed++;
+        }
+    }
+    free(old_rec);
+    free(old_hash);
+
+    info_cache_drop(-1);
+    s_dir.count = (uint16_t)count;
+    s_dir.floor_gen = (uint16_t)(s_dir.gen + 1);   // older records have stale indices
     g_card_count = count;
-    persist_write_int(PERSIST_KEY_COUNT, count);
+    s_table_dirty = (1u << DIR_TABLE_KEYS) - 1;
+    dir_write();
+    return needed;
+}
+
+// True if a card in the list has no stored record (a sync that never finished).
+bool storage_has_missing_cards(void) {
+    for (int i = 0; i < g_card_count; i++) {
+        if (s_rec[i].len == 0) return true;
+    }
+    return false;
+}
+
+// Persist use right now, and what a card set may use (see StorageUsage).
+void storage_get_usage(StorageUsage *out) {
+    int keys = 3 + bit_count(s_dir.live_pages) + bit_count(s_dir.live_tables);
+    int used = 2 * (int)sizeof(int32_t) + (int)sizeof(DirHeader) + s_dir.head +
+               s_dir.count * (int)sizeof(RecordRef) + keys * PERSIST_KEY_OVERHEAD;
+    out->budget = PERSIST_BUDGET;
+    out->used = (uint16_t)used;
+    out->free = (uint16_t)(used < PERSIST_BUDGET ? PERSIST_BUDGET - used : 0);
+    out->capacity = (uint16_t)budget_capacity();
+    out->heap_max = STORAGE_HEAP_SIZE;
+    out->per_card = BUDGET_PER_CARD;
+    out->record_header = sizeof(RecordHeader);
+}
+
+void storage_get_io_stats(StorageIoStats *out) {
+    *out = s_io;
+}
+
+void storage_reset_io_stats(void) {
+    memset(&s_io, 0, sizeof(s_io));
+}
+
+// Remember the last-viewed card so the app can open straight to it next launch.
+void storage_save_last_index(int index) {
+    persist_write_int(PERSIST_KEY_LAST, index);
+}
+
+int storage_load_last_index(void) {
+    return persist_read_int(PERSIST_KEY_LAST);   // 0 if never saved
 }
@@ -0,0 +1,646 @@
+// Host render benchmark + golden-image check.
+// For every corpus entry: draw it the way the detail view does (below the
+// name strip) through both renderer back ends -- graphics_fill_rect and the
+// captured frame buffer -- and report draw calls, pixels touched and ns per
+// frame. Both outputs must match golden/<platform>/<name>.pbm; --update
+// rewrites the goldens. A storage pass then reports persist_* traffic for a
+// save/launch/open cycle with matrices packed the way the phone packs them
+// (checking they unpack exactly), and a generate pass times the on-watch
+// encoders.
+// Exit status is non-zero on any golden mismatch.
+#include "bench.h"
+#include <time.h>
+
+#ifndef HOST_PLATFORM
+#define HOST_PLATFORM "basalt"
+#endif
+
+#define DETAIL_NAME_H 22   // must match main.c
+
+// Globals normally owned by main.c.
+int g_card_count = 0;
+uint8_t g_active_bits[MAX_BITS_LEN];
+
+static const char *s_golden_dir = "golden";
+static bool s_update = false;
+static const char *s_filter = NULL;
+
+// ----------------------------------------------------------------------------
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int hex_nibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Parse "w,h,hex" into a MAX_BITS_LEN buffer (the renderer's read bound).
+static bool parse_matrix(const char *s, uint16_t *w, uint16_t *h, uint8_t *bits) {
+    int iw = 0, ih = 0, consumed = 0;
+    if (sscanf(s, "%d,%d,%n", &iw, &ih, &consumed) != 2 || iw <= 0 || ih <= 0) return false;
+    memset(bits, 0, MAX_BITS_LEN);
+    const char *hex = s + consumed;
+    for (int i = 0; hex[2 * i] && hex[2 * i + 1] && i < MAX_BITS_LEN; i++) {
+        int hi = hex_nibble(hex[2 * i]), lo = hex_nibble(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        bits[i] = (uint8_t)((hi << 4) | lo);
+    }
+    *w = (uint16_t)iw;
+    *h = (uint16_t)ih;
+    return true;
+}
+
+static GRect code_bounds(void) {
+    GSize s = host_screen_size();
+    return GRect(0, DETAIL_NAME_H, s.w, s.h - DETAIL_NAME_H);
+}
+
+static void draw_once(const BenchCase *c, uint16_t w, uint16_t h, const uint8_t *bits) {
+    GContext *ctx = host_screen_reset();
+    barcode_draw(ctx, code_bounds(), c->format, w, h, bits);
+}
+
+// Best-of-8 batches of ~4 ms each, in ns per frame: the minimum filters out
+// scheduler noise better than a mean.
+#define TIME_BATCHES 8
+#define TIME_BATCH_NS 4000000ull
+
+static double time_frames(const BenchCase *c, uint16_t w, uint16_t h, const uint8_t *bits) {
+    double best = 0;
+    for (int b = 0; b < TIME_BATCHES; b++) {
+        int iters = 0;
+        uint64_t start = now_ns(), elapsed = 0;
+        do {
+            draw_once(c, w, h, bits);
+            iters++;
+            elapsed = now_ns() - start;
+        } while (elapsed < TIME_BATCH_NS);
+        double ns = (double)elapsed / iters;
+        if (b == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+// Same, for blitting a pre-rendered cache bitmap (the detail view's redraw).
+// The blit is captured into `pbm` first, so it can be checked like the live
+// paths. The timing is the host mock's per-pixel graphics_draw_bitmap_in_rect,
+// not the firmware's blit: only a mock-vs-mock figure. -1 if the case isn't
+// cached (the detail view draws it live).
+static double time_cached(const BenchCase *c, uint16_t w, uint16_t h, const uint8_t *bits,
+                          uint8_t *pbm) {
+    GRect r = code_bounds();
+    GBitmap *bmp = barcode_render_bitmap(r.size, c->format, w, h, bits);
+    if (!bmp) return -1;
+    graphics_draw_bitmap_in_rect(host_screen_reset(), bmp, r);
+    host_screen_pbm(pbm);
+    double best = 0;
+    for (int b = 0; b < TIME_BATCHES; b++) {
+        int iters = 0;
+        uint64_t start = now_ns(), elapsed = 0;
+        do {
+            GContext *ctx = host_screen_reset();
+            graphics_draw_bitmap_in_rect(ctx, bmp, r);
+            iters++;
+            elapsed = now_ns() - start;
+        } while (elapsed < TIME_BATCH_NS);
+        double ns = (double)elapsed / iters;
+        if (b == 0 || ns < best) best = ns;
+    }
+    gbitmap_destroy(bmp);
+    return best;
+}
+
+// ----------------------------------------------------------------------------
+// Golden images (binary PBM, P4)
+// ----------------------------------------------------------------------------
+
+static void golden_path(char *out, size_t n, const char *name) {
+    snprintf(out, n, "%s/%s/%s.pbm", s_golden_dir, HOST_PLATFORM, name);
+}
+
+static bool golden_write(const char *name, const uint8_t *pbm) {
+    char path[512];
+    golden_path(path, sizeof(path), name);
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    GSize s = host_screen_size();
+    fprintf(f, "P4\n%d %d\n", s.w, s.h);
+    fwrite(pbm, 1, host_screen_pbm_size(), f);
+    fclose(f);
+    return true;
+}
+
+// 1 = match, 0 = mismatch, -1 = missing/unreadable.
+static int golden_compare(const char *name, const uint8_t *pbm) {
+    char path[512];
+    golden_path(path, sizeof(path), name);
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    int w = 0, h = 0;
+    GSize s = host_screen_size();
+    int ok = fscanf(f, "P4 %d %d", &w, &h) == 2 && fgetc(f) != EOF && w == s.w && h == s.h;
+    int n = host_screen_pbm_size();
+    uint8_t *want = malloc(n);
+    if (ok) ok = (int)fread(want, 1, n, f) == n && memcmp(want, pbm, n) == 0;
+    free(want);
+    fclose(f);
+    return ok ? 1 : 0;
+}
+
+// ----------------------------------------------------------------------------
+
+static int bench_render(void) {
+    GSize s = host_screen_size();
+    printf("== render: %s %dx%d ==\n", HOST_PLATFORM, s.w, s.h);
+    printf("%-22s %9s %6s %7s %11s %11s %11s  %s\n", "case", "matrix", "fills", "pixels",
+           "ns/fill", "ns/fb", "ns/cached*", "golden");
+
+    int failures = 0;
+    uint8_t *bits = malloc(MAX_BITS_LEN);
+    uint8_t *pbm_fill = malloc(host_screen_pbm_size());
+    uint8_t *pbm_fb = malloc(host_screen_pbm_size());
+    uint8_t *pbm_cached = malloc(host_screen_pbm_size());
+
+    for (int i = 0; i < BENCH_CORPUS_COUNT; i++) {
+        const BenchCase *c = &BENCH_CORPUS[i];
+        if (s_filter && !strstr(c->name, s_filter)) continue;
+        uint16_t w = 0, h = 0;
+        if (!c->matrix) {
+            // Text-only card: encoded once, as load_current_card_data does.
+            memset(bits, 0, MAX_BITS_LEN);
+            if (!barcode_encode_text(c->format, c->text, bits, MAX_BITS_LEN, &w, &h)) {
+                printf("%-22s encode failed\n", c->name);
+                failures++;
+                continue;
+            }
+        } else if (!parse_matrix(c->matrix, &w, &h, bits)) {
+            printf("%-22s bad matrix\n", c->name);
+            failures++;
+            continue;
+        }
+
+        // graphics_fill_rect back end: counts calls and pixels. The first fill
+        // is barcode_draw's white background; only the module fills count.
+        host_set_frame_buffer_enabled(false);
+        GContext *ctx = host_screen_reset();
+        HostGfxStats before = *host_gfx_stats();
+        graphics_context_set_fill_color(ctx, GColorWhite);
+        graphics_fill_rect(ctx, code_bounds(), 0, GCornerNone);
+        long bg_pixels = host_gfx_stats()->fill_pixels - before.fill_pixels;
+        before = *host_gfx_stats();
+        draw_once(c, w, h, bits);
+        long fills = host_gfx_stats()->fill_calls - before.fill_calls - 1;
+        long pixels = host_gfx_stats()->fill_pixels - before.fill_pixels - bg_pixels;
+        host_screen_pbm(pbm_fill);
+        double ns_fill = time_frames(c, w, h, bits);
+
+        // Frame buffer back end.
+        host_set_frame_buffer_enabled(true);
+        draw_once(c, w, h, bits);
+        host_screen_pbm(pbm_fb);
+        double ns_fb = time_frames(c, w, h, bits);
+        double ns_cached = time_cached(c, w, h, bits, pbm_cached);
+
+        const char *status;
+        if (memcmp(pbm_fill, pbm_fb, host_screen_pbm_size()) != 0) {
+            status = "BACKENDS DIFFER";
+            failures++;
+        } else if (ns_cached >= 0 && memcmp(pbm_cached, pbm_fb, host_screen_pbm_size()) != 0) {
+            status = "CACHED DIFFERS";
+            failures++;
+        } else if (s_update) {
+            status = golden_write(c->name, pbm_fb) ? "updated" : "WRITE FAILED";
+        } else {
+            int g = golden_compare(c->name, pbm_fb);
+            status = g == 1 ? "ok" : g == 0 ? "MISMATCH" : "MISSING";
+            if (g != 1) failures++;
+        }
+
+        char dims[16];
+        snprintf(dims, sizeof(dims), "%s%dx%d", c->matrix ? "" : "t:", w, h);
+        char cached[16];
+        if (ns_cached < 0) snprintf(cached, sizeof(cached), "live");
+        else snprintf(cached, sizeof(cached), "%.0f", ns_cached);
+        printf("%-22s %9s %6ld %7ld %11.0f %11.0f %11s  %s\n", c->name, dims, fills, pixels,
+               ns_fill, ns_fb, cached, status);
+    }
+
+    printf("* host mock's per-pixel blit, mock-only timing; \"live\" = not cached. "
+           "Cached renders are golden-checked too\n");
+    free(bits);
+    free(pbm_fill);
+    free(pbm_fb);
+    free(pbm_cached);
+    return failures;
+}
+
+// Host copy of packMatrix in pebble-js-app.js (MATRIX_CODEC_ROW_RICE). Returns
+// the packed length, or 0 when packing wouldn't beat raw (the phone then sends
+// MATRIX_CODEC_RAW).
+static int pack_row_rice(const uint8_t *bits, int width, int height, uint8_t *out, int out_len) {
+    int total = width * height, raw_len = (total + 7) / 8;
+    int *runs = malloc((total + 1) * sizeof(int));
+    int nruns = 0, run = 0;
+    for (int i = 0; i < total; i++) {
+        int bit = (bits[i >> 3] >> (7 - (i & 7))) & 1;
+        if (i >= width) bit ^= (bits[(i - width) >> 3] >> (7 - ((i - width) & 7))) & 1;
+        if (bit) { runs[nruns++] = run; run = 0; } else run++;
+    }
+    if (run > 0) runs[nruns++] = run;
+
+    int best_k = 0;
+    long best_bits = -1;
+    for (int k = 0; k < 8; k++) {
+        long n = 0;
+        for (int r = 0; r < nruns; r++) n += (runs[r] >> k) + 1 + k;
+        if (best_bits < 0 || n < best_bits) { best_bits = n; best_k = k; }
+    }
+    int len = 1 + (int)((best_bits + 7) / 8);
+    if (len >= raw_len || len > out_len) { free(runs); return 0; }
+
+    memset(out, 0, len);
+    out[0] = (uint8_t)best_k;
+    int pos = 8;
+    for (int r = 0; r < nruns; r++) {
+        for (int q = runs[r] >> best_k; q > 0; q--, pos++) out[pos >> 3] |= 0x80 >> (pos & 7);
+        pos++;
+        for (int j = best_k - 1; j >= 0; j--, pos++) {
+            if ((runs[r] >> j) & 1) out[pos >> 3] |= 0x80 >> (pos & 7);
+        }
+    }
+    free(runs);
+    return len;
+}
+
+static const char *corpus_text(const char *name) {
+    for (int i = 0; i < BENCH_CORPUS_COUNT; i++) {
+        if (!strcmp(BENCH_CORPUS[i].name, name)) return BENCH_CORPUS[i].text;
+    }
+    return "";
+}
+
+// Cards whose stored matrix doesn't unpack to `expect` (or whose text is off).
+static int verify_cards(uint8_t **expect, uint8_t *bits) {
+    char text[MAX_TEXT_LEN + 1];
+    int mismatches = 0;
+    for (int i = 0; i < g_card_count; i++) {
+        const WalletCardInfo *info = storage_card_info(i);
+        if (!info) { mismatches++; continue; }
+        int raw_len = (info->width * info->height + 7) / 8;
+        const char *want = corpus_text(info->name);   // before info is paged out
+        storage_load_card_text(i, text, sizeof(text));
+        if (!storage_load_card_data(i, bits, MAX_BITS_LEN) ||
+            memcmp(bits, expect[i], raw_len) != 0 ||
+            strcmp(text, want) != 0) mismatches++;
+    }
+    return mismatches;
+}
+
+// persist_* traffic for: sync a card set, relaunch (load metadata), open each card.
+// Returns the number of cards (or checks) that didn't read back as expected.
+static int bench_storage(void) {
+    printf("== storage ==\n");
+    int failures = 0;
+    host_persist_clear();
+    storage_load_cards();   // fresh install: writes the schema marker
+    storage_reset_io_stats();
+
+    uint8_t *bits = malloc(MAX_BITS_LEN);
+    uint8_t *packed = malloc(MAX_BITS_LEN);
+    char text[MAX_TEXT_LEN + 1];
+    uint8_t *expect[MAX_CARDS] = { NULL };
+    long raw_total = 0, stored_total = 0;
+    int saved = 0;
+    for (int i = 0; i < BENCH_CORPUS_COUNT && saved < MAX_CARDS; i++) {
+        const BenchCase *c = &BENCH_CORPUS[i];
+        WalletCardInfo info;
+        memset(&info, 0, sizeof(info));
+        if (!c->matrix || !parse_matrix(c->matrix, &info.width, &info.height, bits)) continue;
+        snprintf(info.name, sizeof(info.name), "%s", c->name);
+        info.format = c->format;
+        int raw_len = (info.width * info.height + 7) / 8;
+        int packed_len = pack_row_rice(bits, info.width, info.height, packed, MAX_BITS_LEN);
+        info.codec = packed_len ? MATRIX_CODEC_ROW_RICE : MATRIX_CODEC_RAW;
+        info.hash = 0x1000u + (uint32_t)saved;   // stands in for the phone's content hash
+        info.data_len = (uint16_t)(packed_len ? packed_len : raw_len);
+        info.text_len = (uint16_t)strlen(c->text);
+        storage_save_card(saved, &info, packed_len ? packed : bits, info.data_len,
+                          c->text, info.text_len);
+        expect[saved] = malloc(raw_len);
+        memcpy(expect[saved], bits, raw_len);
+        raw_total += raw_len;
+        stored_total += info.data_len;
+        saved++;
+    }
+    storage_save_count(saved);
+    HostPersistStats *st = host_persist_stats();
+    printf("sync   %2d cards: %5ld writes %5ld deletes %5ld exists  %6ld bytes written\n",
+           saved, st->writes, st->deletes, st->exists, st->bytes_written);
+    // What the watch reports back after a sync (KEY_SYNC_STATS): the page and
+    // directory writes, timed. The rest of st->writes is the card count int.
+    StorageIoStats io;
+    storage_get_io_stats(&io);
+    printf("sync io        : %5u writes %5u deletes  %6u bytes written  %u ms (max %u)\n",
+           (unsigned)io.writes, (unsigned)io.deletes, (unsigned)io.bytes,
+           (unsigned)io.write_ms, (unsigned)io.write_ms_max);
+
+    memset(st, 0, sizeof(*st));
+    storage_load_cards();
+    printf("launch         : %5ld reads  %5ld exists  %6ld bytes read\n",
+           st->reads, st->exists, st->bytes_read);
+
+    memset(st, 0, sizeof(*st));
+    int mismatches = verify_cards(expect, bits);
+    printf("open all %2d    : %5ld reads  %5ld exists  %6ld bytes read\n",
+           g_card_count, st->reads, st->exists, st->bytes_read);
+    printf("codec          : %6ld matrix bytes stored for %ld raw (%.0f%%), %s\n",
+           stored_total, raw_total, raw_total ? 100.0 * stored_total / raw_total : 0.0,
+           mismatches ? "UNPACK MISMATCH" : "all unpack exactly");
+    failures += mismatches;
+
+    // Re-save each card in turn (an edit on the phone) until the page store
+    // has had to compact several times; every card must still read back.
+    memset(st, 0, sizeof(*st));
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < g_card_count; i++) {
+            WalletCardInfo info = *storage_card_info(i);
+            int len = info.data_len;
+            if (info.codec == MATRIX_CODEC_RAW) memcpy(packed, expect[i], len);
+            else pack_row_rice(expect[i], info.width, info.height, packed, MAX_BITS_LEN);
+            storage_load_card_text(i, text, sizeof(text));
+            storage_save_card(i, &info, packed, len, text, info.text_len);
+        }
+    }
+    storage_load_cards();   // relaunch: read everything back from the directory
+    mismatches = verify_cards(expect, bits);
+    printf("resave 3x%-2d    : %5ld writes %5ld deletes  %6ld bytes written, %s\n",
+           g_card_count, st->writes, st->deletes, st->bytes_written,
+           mismatches ? "READBACK MISMATCH" : "all read back exactly");
+    failures += mismatches;
+
+    // Stream every card back in as a sync would: 80-byte chunks straight into
+    // the pages, each one also sent twice (a retried ACK) and the next one
+    // offered early (a lost chunk), which must be refused.
+    memset(st, 0, sizeof(*st));
+    int refused = 0;
+    for (int i = 0; i < g_card_count; i++) {
+        WalletCardInfo info = *storage_card_info(i);
+        int len = info.data_len;
+        if (info.codec == MATRIX_CODEC_RAW) memcpy(packed, expect[i], len);
+        else pack_row_rice(expect[i], info.width, info.height, packed, MAX_BITS_LEN);
+        storage_load_card_text(i, text, sizeof(text));
+        storage_card_stream_begin(i, &info, len, text, info.text_len);
+        for (int off = 0; off < len; off += 80) {
+            int n = len - off < 80 ? len - off : 80;
+            if (off + 80 < len && !storage_card_stream_write(off + 80, packed + off + 80, 1)) refused++;
+            storage_card_stream_write(off, packed + off, n);
+            storage_card_stream_write(off, packed + off, n);
+        }
+        storage_card_stream_commit();
+    }
+    storage_load_cards();
+    mismatches = verify_cards(expect, bits);
+    printf("stream %-2d      : %5ld writes  %6ld bytes written, %d gaps refused, %s\n",
+           g_card_count, st->writes, st->bytes_written, refused,
+           mismatches ? "STREAM MISMATCH" : "all read back exactly");
+    failures += mismatches;
+
+    // A directory table write fails mid-commit (budget full, flash error): the
+    // save must fail and leave the previous directory committed, not a header
+    // naming the failed bank, which the next launch would wipe as damaged.
+    WalletCardInfo first = *storage_card_info(0);
+    if (first.codec == MATRIX_CODEC_RAW) memcpy(packed, expect[0], first.data_len);
+    else pack_row_rice(expect[0], first.width, first.height, packed, MAX_BITS_LEN);
+    storage_load_card_text(0, text, sizeof(text));
+    host_persist_fail_writes(PERSIST_KEY_DIR_TABLE, 4);   // both banks of both keys
+    bool committed = storage_save_card(0, &first, packed, first.data_len, text, first.text_len);
+    host_persist_fail_writes(0, 0);
+    int before = g_card_count;
+    storage_load_cards();
+    mismatches = committed || g_card_count != before ? 1 : verify_cards(expect, bits);
+    printf("table fail     : save %s, %d of %d cards after relaunch, %s\n",
+           committed ? "committed" : "refused", g_card_count, before,
+           mismatches ? "TABLE FAIL MISMATCH" : "old directory kept");
+    failures += mismatches;
+
+    // Damage the newest heap page, as a crash or power loss mid-save could:
+    // opening each card must revert it to an intact older version or drop it,
+    // and the phone then resends only the dropped ones.
+    WalletCardInfo *infos = malloc(sizeof(WalletCardInfo) * MAX_CARDS);
+    for (int i = 0; i < g_card_count; i++) infos[i] = *storage_card_info(i);
+    int last_page = -1;
+    uint8_t page[PERSIST_DATA_MAX_LENGTH];
+    for (int p = 0; p < 32; p++) {
+        if (persist_read_data(PERSIST_KEY_BASE + p, page, sizeof(page)) > 0) last_page = p;
+    }
+    int page_len = persist_read_data(PERSIST_KEY_BASE + last_page, page, sizeof(page));
+    page[page_len / 2] ^= 0x5A;
+    persist_write_data(PERSIST_KEY_BASE + last_page, page, page_len);
+    storage_load_cards();
+    memset(st, 0, sizeof(*st));
+    int dropped = 0;
+    for (int i = 0; i < g_card_count; i++) {
+        if (storage_verify_card(i)) continue;
+        dropped++;
+        int len = infos[i].data_len;
+        if (infos[i].codec == MATRIX_CODEC_RAW) memcpy(packed, expect[i], len);
+        else pack_row_rice(expect[i], infos[i].width, infos[i].height, packed, MAX_BITS_LEN);
+        const char *t = corpus_text(infos[i].name);
+        storage_save_card(i, &infos[i], packed, len, t, infos[i].text_len);   // the resend
+    }
+    free(infos);
+    mismatches = verify_cards(expect, bits);
+    printf("torn page %-2d   : %5d dropped+resent  %5ld reads, %s\n", last_page, dropped,
+           st->reads, mismatches ? "RECOVERY MISMATCH" : "all read back exactly");
+    failures += mismatches;
+
+    // Delta sync of the same set reversed, with the last card edited: only that
+    // card is needed, the rest are remapped without touching any page.
+    memset(st, 0, sizeof(*st));
+    int n = g_card_count;
+    uint8_t manifest[4 * MAX_CARDS];   // little-endian hashes, as the phone sends them
+    uint8_t need[MAX_CARDS], *reordered[MAX_CARDS];
+    for (int i = 0; i < n; i++) {
+        uint32_t hash = i == 0 ? 0xE0E0E0E0u : storage_card_info(n - 1 - i)->hash;
+        for (int b = 0; b < 4; b++) manifest[4 * i + b] = (uint8_t)(hash >> (8 * b));
+        reordered[i] = expect[n - 1 - i];
+    }
+    int needed = storage_apply_manifest(manifest, n, need, MAX_CARDS);
+    bool need_ok = needed == 1 && need[0] == 0;
+    long manifest_writes = st->writes;
+    int delta_mismatches = 0;
+    for (int i = 1; i < n; i++) {
+        const WalletCardInfo *info = storage_card_info(i);
+        int raw_len = info ? (info->width * info->height + 7) / 8 : 0;
+        if (!storage_load_card_data(i, bits, MAX_BITS_LEN) ||
+            memcmp(bits, reordered[i], raw_len) != 0) delta_mismatches++;
+    }
+    printf("delta %2d cards : %5d needed  %5ld writes (directory only), %s\n",
+           n, needed, manifest_writes,
+           need_ok && !delta_mismatches ? "kept cards read back exactly" : "DELTA MISMATCH");
+    failures += delta_mismatches + !need_ok;
+    for (int i = 0; i < saved; i++) free(expect[i]);
+
+    // Wide raw cards on a fresh store: each record spans three or more pages,
+    // so the page frames evict mid-stream and the commit's CRC pass has to
+    // read the evicted pages back. Then a replacement stream is aborted: the
+    // old version must stay readable, before and after a relaunch.
+    host_persist_clear();
+    storage_load_cards();
+    enum { WIDE_CARDS = 3, WIDE_W = 140, WIDE_H = 40, WIDE_LEN = WIDE_W * WIDE_H / 8 };
+    char wide_text[WIDE_CARDS][64];
+    for (int i = 0; i < WIDE_CARDS; i++) {
+        WalletCardInfo info;
+        memset(&info, 0, sizeof(info));
+        snprintf(info.name, sizeof(info.name), "Wide %d", i);
+        info.format = FORMAT_PDF417;
+        info.codec = MATRIX_CODEC_RAW;
+        info.width = WIDE_W;
+        info.height = WIDE_H;
+        info.hash = 0x3000u + (uint32_t)i;
+        info.data_len = WIDE_LEN;
+        for (int b = 0; b < WIDE_LEN; b++) packed[b] = (uint8_t)(b * 37 + i * 101);
+        snprintf(wide_text[i], sizeof(wide_text[i]), "M1WIDE/CARD %d E1234567 LHRJFK 0001", i);
+        info.text_len = (uint16_t)strlen(wide_text[i]);
+        storage_card_stream_begin(i, &info, WIDE_LEN, wide_text[i], info.text_len);
+        for (int off = 0; off < WIDE_LEN; off += 200) {
+            storage_card_stream_write(off, packed + off, WIDE_LEN - off < 200 ? WIDE_LEN - off : 200);
+        }
+        storage_card_stream_commit();
+    }
+    storage_save_count(WIDE_CARDS);
+    WalletCardInfo wide0 = *storage_card_info(0);
+    wide0.hash = 0x3FFFu;
+    storage_card_stream_begin(0, &wide0, WIDE_LEN, "replacement", 11);
+    storage_card_stream_write(0, packed, 300);
+    int wide_bad = storage_card_info(0) && storage_card_info(0)->hash == 0x3000u ? 0 : 1;
+    storage_card_stream_abort();
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass) storage_load_cards();
+        for (int i = 0; i < WIDE_CARDS; i++) {
+            const WalletCardInfo *info = storage_card_info(i);
+            if (!info || info->hash != 0x3000u + (uint32_t)i) { wide_bad++; continue; }
+            storage_load_card_text(i, text, sizeof(text));
+            bool ok = storage_load_card_data(i, bits, MAX_BITS_LEN) && !strcmp(text, wide_text[i]);
+            for (int b = 0; ok && b < WIDE_LEN; b++) ok = bits[b] == (uint8_t)(b * 37 + i * 101);
+            if (!ok) wide_bad++;
+        }
+    }
+    printf("stream wide %d  : %d-byte matrices + text, 3+ pages each, abort keeps old, %s\n",
+           WIDE_CARDS, WIDE_LEN, wide_bad ? "WIDE MISMATCH" : "all read back exactly");
+    failures += wide_bad;
+    free(packed);
+    free(bits);
+
+    // A large catalog of text-only cards: launch reads only the directory, and
+    // scrolling the whole menu pages each row's header in once.
+    host_persist_clear();
+    storage_load_cards();
+    int catalog = 0;
+    for (; catalog < MAX_CARDS && catalog < 100; catalog++) {
+        WalletCardInfo info;
+        memset(&info, 0, sizeof(info));
+        snprintf(info.name, sizeof(info.name), "Loyalty %03d", catalog);
+        snprintf(info.description, sizeof(info.description), "Store");
+        info.format = FORMAT_EAN13;
+        info.hash = 0x2000u + (uint32_t)catalog;
+        snprintf(text, sizeof(text), "400638%06d", catalog);
+        info.text_len = (uint16_t)strlen(text);
+        if (!storage_save_card(catalog, &info, NULL, 0, text, info.text_len)) break;
+    }
+    storage_save_count(catalog);
+    memset(st, 0, sizeof(*st));
+    storage_load_cards();
+    long launch_reads = st->reads, launch_bytes = st->bytes_read;
+    memset(st, 0, sizeof(*st));
+    int rows_ok = 0;
+    for (int i = 0; i < g_card_count; i++) {
+        const WalletCardInfo *info = storage_card_info(i);
+        char want[MAX_NAME_LEN];
+        snprintf(want, sizeof(want), "Loyalty %03d", i);
+        if (info && !strcmp(info->name, want)) rows_ok++;
+    }
+    printf("catalog %3d    : launch %ld reads %ld bytes, menu scroll %ld reads, %s\n",
+           g_card_count, launch_reads, launch_bytes, st->reads,
+           rows_ok == g_card_count ? "all rows read back" : "ROW MISMATCH");
+    failures += g_card_count - rows_ok;
+    StorageUsage u;
+    storage_get_usage(&u);
+    printf("budget         : %5d used %5d free of %d (set capacity %d, %d per card)\n",
+           u.used, u.free, u.budget, u.capacity, u.per_card);
+    return failures;
+}
+
+// ----------------------------------------------------------------------------
+
+// On-watch generation (barcode_encode_text, as a text-only card load runs it)
+// across each encoder's size range. Best-of-batches like the render timings.
+static const struct { const char *name; BarcodeFormat format; const char *text; } GEN_BENCH[] = {
+    { "qr_alnum_short", FORMAT_QR, "HTTPS://EXAMPLE.COM/L/8842" },
+    { "qr_numeric_40", FORMAT_QR, "9900123456789012345678901234567890123456" },
+    { "qr_byte_url", FORMAT_QR, "https://wallet.example.com/pass/8f3a9c2e-4b1d-4e6f-9a7c-2d5e8b1f0c3a?member=00417" },
+    { "qr_byte_bcbp", FORMAT_QR,
+      "M1DOE/JOHNATHAN EMR  E1A2B3C JFKLAXAA 0123 045Y012C0034 147>5181OO1045BAA 0000000000000"
+      "2900123456789012 AA AA 12345678901234567    *30600000K09  AAAA1234567890ABCDEFGHIJKLMNOP" },
+    { "ean13_retail", FORMAT_EAN13, "400638133393" },
+    { "code39_library", FORMAT_CODE39, "LIB29857341" },
+    { "itf14_carton", FORMAT_ITF, "1234567890123" },
+    { "aztec_ticket", FORMAT_AZTEC, "TKT 4471-0093 Zone 1-4 adult" },
+    { "aztec_url", FORMAT_AZTEC, "https://wallet.example.com/pass/8f3a9c2e-4b1d-4e6f-9a7c-2d5e8b1f0c3a?member=00417" },
+    { "aztec_bcbp", FORMAT_AZTEC,
+      "M1DOE/JOHNATHAN EMR  E1A2B3C JFKLAXAA 0123 045Y012C0034 147>5181OO1045BAA 0000000000000"
+      "2900123456789012 AA AA 12345678901234567    *30600000K09  AAAA1234567890ABCDEFGHIJKLMNOP" },
+};
+
+static void bench_generate(void) {
+    printf("== generate ==\n");
+    printf("%-16s %7s %11s\n", "case", "size", "ns/encode");
+    uint8_t *out = malloc(MAX_BITS_LEN);
+    for (size_t i = 0; i < sizeof(GEN_BENCH) / sizeof(GEN_BENCH[0]); i++) {
+        uint16_t w = 0, h = 0;
+        if (!barcode_encode_text(GEN_BENCH[i].format, GEN_BENCH[i].text, out, MAX_BITS_LEN, &w, &h)) {
+            printf("%-16s too large\n", GEN_BENCH[i].name);
+            continue;
+        }
+        double best = 0;
+        for (int b = 0; b < TIME_BATCHES; b++) {
+            int iters = 0;
+            uint64_t start = now_ns(), elapsed = 0;
+            do {
+                barcode_encode_text(GEN_BENCH[i].format, GEN_BENCH[i].text, out, MAX_BITS_LEN, &w, &h);
+                iters++;
+                elapsed = now_ns() - start;
+            } while (elapsed < TIME_BATCH_NS);
+            double ns = (double)elapsed / iters;
+            if (b == 0 || ns < best) best = ns;
+        }
+        char dims[16];
+        snprintf(dims, sizeof(dims), "%dx%d", w, h);
+        printf("%-16s %7s %11.0f\n", GEN_BENCH[i].name, dims, best);
+    }
+    free(out);
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--update")) s_update = true;
+        else if (!strcmp(argv[i], "--golden") && i + 1 < argc) s_golden_dir = argv[++i];
+        else if (!strcmp(argv[i], "--filter") && i + 1 < argc) s_filter = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--update] [--golden DIR] [--filter NAME]\n", argv[0]);
+            return 2;
+        }
+    }
+    int failures = bench_render();
+    int storage_failures = bench_storage();
+    bench_generate();
+    if (failures) printf("%d render check(s) failed\n", failures);
+    if (storage_failures) printf("%d storage check(s) failed\n", storage_failures);
+    return failures || storage_failures ? 1 : 0;
+}
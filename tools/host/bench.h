@@ -0,0 +1,14 @@
+#pragma once
+#include "common.h"
+
+// One render-corpus entry (see corpus.c).
+typedef struct {
+    const char *name;
+    BarcodeFormat format;
+    const char *text;     // human-readable payload, "" if unknown
+    const char *matrix;   // "w,h,hex" exactly as the config page stores card.data,
+                          // or NULL for a text-only card (encoded on the watch)
+} BenchCase;
+
+extern const BenchCase BENCH_CORPUS[];
+extern const int BENCH_CORPUS_COUNT;
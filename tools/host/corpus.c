@@ -0,0 +1,122 @@
+// Render corpus: one entry per symbology/size the watch actually shows.
+// Matrices use the config page's card.data format ("w,h,hex": continuous
+// MSB-first bit packing, cropped, one row for 1D codes), so a real card can be
+// pasted in straight from the phone's localStorage.
+// The Aztec and PDF417 entries are structurally faithful stand-ins (correct
+// finder/start/stop structure and module statistics, random payload): they
+// exercise the renderer like real symbols but won't decode.
+#include "bench.h"
+
+const BenchCase BENCH_CORPUS[] = {
+    // Code 128C, 16 digits (demo Starbucks card).
+    { "code128c_starbucks", FORMAT_CODE128, "6035550123456789",
+      "123,1,"
+      "D39DEA23746CD9DBAEC42CDBD3731D60" },
+    // Code 128B, alphanumeric member id.
+    { "code128b_member", FORMAT_CODE128, "MEMBER-00417-XK",
+      "200,1,"
+      "D21762345D88B11A3174DC9D93B3274E6EDD3738B58EEBD8EB" },
+    // Code 39 at the config page's 2:1 wide:narrow ratio.
+    { "code39_library", FORMAT_CODE39, "LIB29857341",
+      "168,1,"
+      "96D5A9AD35696B2B596B4B5A6AA5B6CAA9ADA5696D" },
+    // EAN-13 with computed check digit.
+    { "ean13_retail", FORMAT_EAN13, "4006381333931",
+      "95,1,"
+      "A353AF7A259AA14285D2166A" },
+    // QR 25x25 from the watch encoder (src/qr.c), alphanumeric, EC L.
+    { "qr_v2_url", FORMAT_QR, "HTTPS://EXAMPLE.COM/L/8842",
+      "25,25,"
+      "FE21BFC121106EA4ABB749A5DBA4EAEC11D507FAAAFE012000EF89E25EAEB4E0"
+      "EE87E3BDD23CA327A187948E7F96C0D8E0B88EC8FC807E457FA6ABB051F14BA9"
+      "2FF5D29A6AEA902305629FFEC9DE80" },
+    // QR 25x25 from the watch encoder (src/qr.c), alphanumeric, EC L.
+    { "qr_v2_bcbp_short", FORMAT_QR, "M1DOE/JOHN E ABC123 JFKLAX",
+      "25,25,"
+      "FE233FC120506EA42BB74985DBA4E2EC11D107FAAAFE012300EF89623E6E92A4"
+      "EEC6439DEBE62B3599C39D36EC972CCBA1109EE8FF004E477FBEAB3055D10BA9"
+      "2FD5D093BAEA92D30521ABFEE91E80" },
+    // QR 33x33 from the watch encoder (src/qr.c), alphanumeric, EC L.
+    { "qr_v4_loyalty", FORMAT_QR, "LOYALTY:7730-4412-9981-0035 MEMBER SINCE 2019 TIER GOLD POINTS 120455 REF 99X-44Z-0017-AB",
+      "33,33,"
+      "FE25F83FC122CDD06EA51CABB7494BF5DBA4CA02EC11EB1907FAAAAAFE012E7A"
+      "00EF8CE262586EA2D266CEAAE18D9DAEA390BB2DE9CB498B6726AE11963CD0E3"
+      "B39246689532146E66AAA39EAB0C23A5FF26A92F35BB72649E73A24D1306A8C3"
+      "A287B6BA8946FD006ECC457FA6D8EA9059D0D16BA9203F95D19E938EEA15020B"
+      "0560E173FE88784680" },
+    // Compact Aztec, 2 layers: real bullseye and orientation marks, random data.
+    { "aztec_c2_synth", FORMAT_AZTEC, "",
+      "19,19,"
+      "2F2D90A69A5BD6D3AC0FE5BEDFFE99013D6FBA751584AAF7145806FA54C0722F"
+      "FDF81E1AE4AAD68143C834262F80" },
+    // Compact Aztec, 4 layers: real bullseye and orientation marks, random data.
+    { "aztec_c4_synth", FORMAT_AZTEC, "",
+      "27,27,"
+      "163E7C097EDFF5FB41113006105DB497788214F180079933D25C593BC62F7F9F"
+      "FC6D2B0157F8EFB2A74D1563CDAABF24B45EF58AFBF7BCC05768DFFC3ACC7621"
+      "D42D202608E0BAE7D02310336D3D3F6E650BDA16C9C4DF80EBA90880" },
+    // PDF417, 3 data columns x 24 rows: real start/stop patterns, random codewords
+    // drawn from the correct cluster for each row (so bar/space statistics match).
+    { "pdf417_c3_synth", FORMAT_PDF417, "",
+      "120,24,"
+      "FF544228394E1D3BE90286E763FA29FF547CC8B98E582E8E23172343FA29FF54"
+      "599E3763D4BC0F75F77A73FA29FF54632821DC9DAC0848244283FA29FF547B71"
+      "B0875D9C8F05B761D3FA29FF54431723139BC2CE5F15E503FA29FF5442F7B8D3"
+      "130C4C19165873FA29FF54794429E21EB18F37659FB3FA29FF545E61B18BDFA6"
+      "8D99F506FBFA29FF5440C6A871D0490C67772CF3FA29FF547B343E769F66CCBE"
+      "77B60BFA29FF5461D3BC5E51E848CCF67D23FA29FF547731B3CE93620DDC64A1"
+      "03FA29FF5450F125E09D7B88BC242F43FA29FF547EDCB28F91E42C7C56F673FA"
+      "29FF5440C6B339D8636CA6077243FA29FF546C793B709C8E6C839723B3FA29FF"
+      "5448BC3D0F53C66C9BF797DBFA29FF5450C620DA1CD9CF42F79AE3FA29FF5448"
+      "3CBD0A1F446D0E17EE4BFA29FF5440EB3DAFDA3F4D13E5DEFBFA29FF54787AB8"
+      "75118D0E22E77283FA29FF54427DA08F57ECEB3E1605D3FA29FF5477E5378590"
+      "ECEB06F4FB43FA29" },
+    // PDF417, 4 data columns x 40 rows, the size of a full BCBP boarding pass.
+    // Same construction as above.
+    { "pdf417_c4_bcbp_synth", FORMAT_PDF417, "",
+      "137,40,"
+      "FF544263350312E0EFBE564CE31825FD14FFAA24789717CB13F53E6323CDD874"
+      "FE8A7FD51E4F29CB060FAB1C5D65C0973F7F453FEA8C1A27503B604904248A04"
+      "49083FA29FF5442FB22F41F0CAF89651E43C225FD14FFAA3782DD7C2990760FA"
+      "A61397CC4FE8A7FD5138E2D26040B639E35B8C8B87B7F453FEA8FA9873BD36F1"
+      "1EB18C9D074E33FA29FF544D072F0493438864E4E8C2C0B9FD14FFAA3A171033"
+      "4AF1E40943BBB9E792FE8A7FD51F622D3C37D41BC8CDD3DC9E9E7F453FEA88E4"
+      "64705B75C13B9E8F6347C6BFA29FF544E7221221AC7087725B042E78DFD14FFA"
+      "A2D3F185ECE23B4178BA1A1DB82FE8A7FD51BECC86CF6617A78157B0CCA1F7F4"
+      "53FEA88877587BB36191B04E34C7137BFA29FF546270A1EBD3AF8D83D62F1BCB"
+      "31FD14FFAA364793DDCDE676BF0AF8C9ED7EFE8A7FD51A118960658F73C69D0B"
+      "18821B7F453FEA8F233723138B8DF46E8DF45FA1BFA29FF544F143E8E578289C"
+      "98425E289E1FD14FFAA2D841B048F32E5C7220EE9EC9CFE8A7FD51FBA8D0E153"
+      "C0B47DD027AD1E37F453FEA8FD9D5E4431F45BE488EEF72FDBFA29FF547399BD"
+      "DB973A08121739422141FD14FFAA3EF7588E8D7044BC123D3D9702FE8A7FD51B"
+      "AE0FD1A5E63278A1A3F2AC1F7F453FEA8DD825B98313713CF2DDCC6EC43FA29F"
+      "F546B88393417A1EC4E44FD633BE5FD14FFAA3C9E97EF6B98759702C8716EF8F"
+      "E8A7FD513DF6E58F7B13A638DCDDEA0667F453FEA8EC7275CC391891EBCD1E35"
+      "0F13FA29FF545C673B93D07A49C8663E923B1DFD14FFAA3845D1036C61B46C42"
+      "11DD9CE6FE8A7FD519BC8EB8C50F0A2FB1987AC4747F453FEA89A0E6FB638FAD"
+      "1E82EE9E4A0F3FA29FF5461A42220943DEA0EE4330A1991FD14FFAA233E9D064"
+      "9FA67902A23ED99E2FE8A7FD51CCBE99BC5ED8279116CF0E17D7F453FEA8D3BC"
+      "7611A4631DD04C85870D1BFA29" },
+    // Text-only cards: the watch encodes these itself.
+    { "code128_text_mixed", FORMAT_CODE128, "AB-12345678-cd", NULL },
+    { "code128_text_gs1", FORMAT_CODE128, "]C1011234567890123\x1D" "10LOT42", NULL },
+    { "qr_text_numeric", FORMAT_QR, "990012345678901234567890", NULL },
+    { "qr_text_url_byte", FORMAT_QR,
+      "https://wallet.example.com/pass/8f3a9c2e-4b1d-4e6f-9a7c-2d5e8b1f0c3a?member=00417&tier=gold", NULL },
+    // MAX_TEXT_LEN (255) bytes of ASCII: the longest text a card syncs as text only.
+    { "qr_text_v10_max", FORMAT_QR,
+      "https://loyalty.example.org/member/card?id=7731-0042-9918-5520&name=Jane%20Q.%20"
+      "Public&tier=Platinum+&since=2019-04-01&store=Downtown%20Market%20%2312&sig=Xq9vL"
+      "mT3bR8kWzP2nY6hJ4dF0sA1cE5gU7iO&ref=ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqr"
+      "stuvwxyz0123456", NULL },
+    { "ean8_text", FORMAT_EAN8, "96385074", NULL },
+    { "upca_text", FORMAT_UPCA, "036000291452", NULL },
+    { "code39_text", FORMAT_CODE39, "LIB29857341", NULL },
+    { "itf14_text", FORMAT_ITF, "1234567890123", NULL },
+    { "aztec_text_compact", FORMAT_AZTEC, "TKT 4471-0093 Zone 1-4 adult", NULL },
+    { "aztec_text_rail", FORMAT_AZTEC,
+      "#UT01RAIL0000123456789ABC/2026-10-16T07:42 Paris Gare de Lyon->Lyon Part-Dieu "
+      "voiture 14 place 082 tarif Loisir 2nde; passager DUPONT/MARIE", NULL },
+};
+
+const int BENCH_CORPUS_COUNT = sizeof(BENCH_CORPUS) / sizeof(BENCH_CORPUS[0]);
@@ -0,0 +1,125 @@
+// Host stand-in for <pebble.h>.
+// Just enough of the Pebble SDK for the watch's render, encoder and storage
+// code (src/barcodes.c, src/qr.c, src/storage.c) to build and run on Linux:
+// - graphics_fill_rect is recorded (call count, pixels touched) and rasterised
+//   into a frame buffer sized like the selected platform's screen;
+// - graphics_capture_frame_buffer hands that buffer out in the platform's real
+//   format (1-bit on aplite, 8-bit on color, 8-bit circular rows on chalk);
+// - persist_* is an in-memory key/value store with per-call counters;
+// - time_ms reads the host's wall clock.
+// The platform is chosen at compile time (see Makefile): PBL_BW/PBL_COLOR,
+// PBL_RECT/PBL_ROUND and HOST_SCREEN_W/HOST_SCREEN_H.
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// --- Geometry / color ---
+typedef struct { int16_t x, y; } GPoint;
+typedef struct { int16_t w, h; } GSize;
+typedef struct { GPoint origin; GSize size; } GRect;
+#define GPoint(x, y) ((GPoint){ (int16_t)(x), (int16_t)(y) })
+#define GSize(w, h) ((GSize){ (int16_t)(w), (int16_t)(h) })
+#define GRect(x, y, w, h) ((GRect){ { (int16_t)(x), (int16_t)(y) }, { (int16_t)(w), (int16_t)(h) } })
+
+typedef union { uint8_t argb; } GColor8;
+typedef GColor8 GColor;
+#define GColorBlack ((GColor8){ .argb = 0xC0 })
+#define GColorWhite ((GColor8){ .argb = 0xFF })
+typedef enum { GCornerNone = 0 } GCornerMask;
+
+// --- Bitmaps ---
+typedef enum {
+    GBitmapFormat1Bit = 0,
+    GBitmapFormat8Bit,
+    GBitmapFormat1BitPalette,
+    GBitmapFormat2BitPalette,
+    GBitmapFormat4BitPalette,
+    GBitmapFormat8BitCircular,
+} GBitmapFormat;
+typedef struct GBitmap GBitmap;
+typedef struct { uint8_t *data; int16_t min_x, max_x; } GBitmapDataRowInfo;
+
+GBitmap *gbitmap_create_blank(GSize size, GBitmapFormat format);
+void gbitmap_destroy(GBitmap *bitmap);
+uint8_t *gbitmap_get_data(const GBitmap *bitmap);
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap);
+GBitmapFormat gbitmap_get_format(const GBitmap *bitmap);
+GRect gbitmap_get_bounds(const GBitmap *bitmap);
+GBitmapDataRowInfo gbitmap_get_data_row_info(const GBitmap *bitmap, uint16_t y);
+
+// --- Graphics ---
+typedef struct GContext GContext;
+typedef const char *GFont;
+typedef enum { GTextOverflowModeWordWrap, GTextOverflowModeTrailingEllipsis } GTextOverflowMode;
+typedef enum { GTextAlignmentLeft, GTextAlignmentCenter, GTextAlignmentRight } GTextAlignment;
+#define FONT_KEY_GOTHIC_14 "GOTHIC_14"
+#define FONT_KEY_GOTHIC_18_BOLD "GOTHIC_18_BOLD"
+#define FONT_KEY_GOTHIC_24_BOLD "GOTHIC_24_BOLD"
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color);
+void graphics_context_set_text_color(GContext *ctx, GColor color);
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask mask);
+void graphics_draw_text(GContext *ctx, const char *text, GFont font, GRect box,
+                        GTextOverflowMode overflow, GTextAlignment alignment, void *attributes);
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect);
+GBitmap *graphics_capture_frame_buffer(GContext *ctx);
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer);
+GFont fonts_get_system_font(const char *font_key);
+
+// --- System ---
+size_t heap_bytes_free(void);
+
+#define APP_LOG_LEVEL_ERROR 1
+#define APP_LOG_LEVEL_WARNING 50
+#define APP_LOG_LEVEL_INFO 100
+#define APP_LOG_LEVEL_DEBUG 200
+void host_app_log(int level, const char *fmt, ...);
+#define APP_LOG(level, ...) host_app_log((level), __VA_ARGS__)
+
+// --- Persistent storage ---
+#define PERSIST_DATA_MAX_LENGTH 256
+bool persist_exists(uint32_t key);
+int32_t persist_read_int(uint32_t key);
+int persist_write_int(uint32_t key, int32_t value);
+int persist_read_data(uint32_t key, void *buffer, size_t buffer_size);
+int persist_write_data(uint32_t key, const void *data, size_t size);
+int persist_delete(uint32_t key);
+
+// --- Time ---
+uint16_t time_ms(time_t *t_utc, uint16_t *out_ms);
+
+// ============================================================================
+// Host-only controls (not part of the SDK) used by bench.c
+// ============================================================================
+
+typedef struct {
+    long fill_calls;      // graphics_fill_rect calls
+    long fill_pixels;     // on-screen pixels those calls wrote
+    long bitmap_draws;    // graphics_draw_bitmap_in_rect calls
+    long fb_captures;     // graphics_capture_frame_buffer calls
+} HostGfxStats;
+
+typedef struct {
+    long exists, reads, writes, deletes;
+    long bytes_read, bytes_written;
+} HostPersistStats;
+
+// Reset the screen to white and return the context to draw into.
+GContext *host_screen_reset(void);
+// false: graphics_capture_frame_buffer returns NULL (the fill_rect fallback).
+void host_set_frame_buffer_enabled(bool enabled);
+HostGfxStats *host_gfx_stats(void);
+HostPersistStats *host_persist_stats(void);
+void host_persist_clear(void);
+// Writes to keys [first, first + count) fail (return -1) until reset with count 0.
+void host_persist_fail_writes(uint32_t first, uint32_t count);
+
+// Screen as 1-bit PBM (P4) bytes: ceil(w/8) bytes per row, MSB left, 1 = black.
+int host_screen_pbm_size(void);
+void host_screen_pbm(uint8_t *out);
+GSize host_screen_size(void);
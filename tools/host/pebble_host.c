@@ -0,0 +1,330 @@
+// Host implementation of the stand-in SDK declared in pebble.h.
+#include <pebble.h>
+#include <stdarg.h>
+
+#ifndef HOST_SCREEN_W
+#define HOST_SCREEN_W 144
+#endif
+#ifndef HOST_SCREEN_H
+#define HOST_SCREEN_H 168
+#endif
+
+struct GBitmap {
+    GBitmapFormat format;
+    int w, h, stride;
+    uint8_t *data;
+    bool round;          // per-row visible range (chalk's circular frame buffer)
+};
+
+struct GContext {
+    GColor fill;
+    GBitmap *fb;
+};
+
+static GBitmap s_fb;
+static GContext s_ctx;
+static bool s_fb_enabled = true;
+static HostGfxStats s_gfx;
+
+// ----------------------------------------------------------------------------
+// Pixels
+// ----------------------------------------------------------------------------
+
+static int stride_for(GBitmapFormat format, int w) {
+    return format == GBitmapFormat1Bit ? ((w + 31) / 32) * 4 : w;
+}
+
+// Visible span of each row of the round display, computed once.
+static int16_t s_round_min[HOST_SCREEN_H], s_round_max[HOST_SCREEN_H];
+static bool s_round_ready = false;
+
+static void round_table_init(void) {
+    int r = HOST_SCREEN_W / 2;
+    for (int y = 0; y < HOST_SCREEN_H; y++) {
+        int dy = 2 * y + 1 - HOST_SCREEN_H;       // doubled, measured at pixel centres
+        int dx = 0;
+        while (dx < r && (2 * dx + 1) * (2 * dx + 1) + dy * dy <= 4 * r * r) dx++;
+        s_round_min[y] = (int16_t)(r - dx);
+        s_round_max[y] = (int16_t)(r + dx - 1);
+    }
+    s_round_ready = true;
+}
+
+// Visible columns of row y: everything on rect screens, the disc on round ones.
+static void row_range(const GBitmap *b, int y, int *min_x, int *max_x) {
+    *min_x = 0;
+    *max_x = b->w - 1;
+    if (!b->round) return;
+    if (!s_round_ready) round_table_init();
+    *min_x = s_round_min[y];
+    *max_x = s_round_max[y];
+}
+
+static bool pixel_black(const GBitmap *b, int x, int y) {
+    if (b->format == GBitmapFormat1Bit) {
+        return !((b->data[y * b->stride + (x >> 3)] >> (x & 7)) & 1);
+    }
+    return b->data[y * b->stride + x] == GColorBlack.argb;
+}
+
+static void pixel_set(GBitmap *b, int x, int y, bool black) {
+    if (b->format == GBitmapFormat1Bit) {
+        uint8_t *p = &b->data[y * b->stride + (x >> 3)];
+        uint8_t m = (uint8_t)(1 << (x & 7));
+        *p = black ? (uint8_t)(*p & ~m) : (uint8_t)(*p | m);
+    } else {
+        b->data[y * b->stride + x] = black ? GColorBlack.argb : GColorWhite.argb;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Bitmaps
+// ----------------------------------------------------------------------------
+
+GBitmap *gbitmap_create_blank(GSize size, GBitmapFormat format) {
+    GBitmap *b = calloc(1, sizeof(GBitmap));
+    if (!b) return NULL;
+    b->format = format;
+    b->w = size.w;
+    b->h = size.h;
+    b->stride = stride_for(format, size.w);
+    b->data = calloc(b->stride, size.h);
+    if (!b->data) { free(b); return NULL; }
+    return b;
+}
+
+void gbitmap_destroy(GBitmap *bitmap) {
+    if (!bitmap) return;
+    free(bitmap->data);
+    free(bitmap);
+}
+
+uint8_t *gbitmap_get_data(const GBitmap *bitmap) { return bitmap->data; }
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap) { return bitmap->stride; }
+GBitmapFormat gbitmap_get_format(const GBitmap *bitmap) { return bitmap->format; }
+GRect gbitmap_get_bounds(const GBitmap *bitmap) { return GRect(0, 0, bitmap->w, bitmap->h); }
+
+GBitmapDataRowInfo gbitmap_get_data_row_info(const GBitmap *bitmap, uint16_t y) {
+    int min_x, max_x;
+    row_range(bitmap, y, &min_x, &max_x);
+    return (GBitmapDataRowInfo){ bitmap->data + y * bitmap->stride, min_x, max_x };
+}
+
+// ----------------------------------------------------------------------------
+// Graphics
+// ----------------------------------------------------------------------------
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color) { ctx->fill = color; }
+void graphics_context_set_text_color(GContext *ctx, GColor color) { (void)ctx; (void)color; }
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask mask) {
+    (void)corner_radius; (void)mask;
+    s_gfx.fill_calls++;
+    bool black = ctx->fill.argb == GColorBlack.argb;
+    for (int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++) {
+        if (y < 0 || y >= ctx->fb->h) continue;
+        int min_x, max_x;
+        row_range(ctx->fb, y, &min_x, &max_x);
+        int x0 = rect.origin.x > min_x ? rect.origin.x : min_x;
+        int x1 = rect.origin.x + rect.size.w - 1 < max_x ? rect.origin.x + rect.size.w - 1 : max_x;
+        if (x0 > x1) continue;
+        s_gfx.fill_pixels += x1 - x0 + 1;
+        if (ctx->fb->format == GBitmapFormat1Bit) {
+            for (int x = x0; x <= x1; x++) pixel_set(ctx->fb, x, y, black);
+        } else {
+            memset(ctx->fb->data + y * ctx->fb->stride + x0,
+                   black ? GColorBlack.argb : GColorWhite.argb, x1 - x0 + 1);
+        }
+    }
+}
+
+// Text isn't rasterised; the bench only measures barcode modules.
+void graphics_draw_text(GContext *ctx, const char *text, GFont font, GRect box,
+                        GTextOverflowMode overflow, GTextAlignment alignment, void *attributes) {
+    (void)ctx; (void)text; (void)font; (void)box; (void)overflow; (void)alignment; (void)attributes;
+}
+
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect) {
+    s_gfx.bitmap_draws++;
+    for (int y = 0; y < rect.size.h && y < bitmap->h; y++) {
+        int sy = rect.origin.y + y;
+        if (sy < 0 || sy >= ctx->fb->h) continue;
+        int min_x, max_x;
+        row_range(ctx->fb, sy, &min_x, &max_x);
+        for (int x = 0; x < rect.size.w && x < bitmap->w; x++) {
+            int sx = rect.origin.x + x;
+            if (sx < min_x || sx > max_x) continue;
+            pixel_set(ctx->fb, sx, sy, pixel_black(bitmap, x, y));
+        }
+    }
+}
+
+GBitmap *graphics_capture_frame_buffer(GContext *ctx) {
+    if (!s_fb_enabled) return NULL;
+    s_gfx.fb_captures++;
+    return ctx->fb;
+}
+
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer) {
+    (void)ctx; (void)buffer;
+    return true;
+}
+
+GFont fonts_get_system_font(const char *font_key) { return font_key; }
+
+// ----------------------------------------------------------------------------
+// System
+// ----------------------------------------------------------------------------
+
+size_t heap_bytes_free(void) {
+#if defined(PBL_PLATFORM_APLITE)
+    return 18000;
+#else
+    return 60000;
+#endif
+}
+
+void host_app_log(int level, const char *fmt, ...) {
+    if (!getenv("HOST_APP_LOG")) return;
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "[%d] ", level);
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+    va_end(ap);
+}
+
+// ----------------------------------------------------------------------------
+// Persistent storage: 4 KB-ish of 256-byte values, like the watch.
+// ----------------------------------------------------------------------------
+
+#define HOST_PERSIST_KEYS 32768
+typedef struct { bool used; uint16_t len; uint8_t data[PERSIST_DATA_MAX_LENGTH]; } HostValue;
+static HostValue *s_values;
+static HostPersistStats s_persist;
+static uint32_t s_fail_first, s_fail_count;   // host_persist_fail_writes
+
+static HostValue *value_for(uint32_t key) {
+    if (!s_values) s_values = calloc(HOST_PERSIST_KEYS, sizeof(HostValue));
+    return key < HOST_PERSIST_KEYS ? &s_values[key] : NULL;
+}
+
+bool persist_exists(uint32_t key) {
+    s_persist.exists++;
+    HostValue *v = value_for(key);
+    return v && v->used;
+}
+
+int32_t persist_read_int(uint32_t key) {
+    s_persist.reads++;
+    HostValue *v = value_for(key);
+    int32_t out = 0;
+    if (v && v->used) memcpy(&out, v->data, sizeof(out));
+    return out;
+}
+
+int persist_write_int(uint32_t key, int32_t value) {
+    s_persist.writes++;
+    HostValue *v = value_for(key);
+    if (!v) return -1;
+    v->used = true;
+    v->len = sizeof(value);
+    memcpy(v->data, &value, sizeof(value));
+    s_persist.bytes_written += sizeof(value);
+    return sizeof(value);
+}
+
+int persist_read_data(uint32_t key, void *buffer, size_t buffer_size) {
+    s_persist.reads++;
+    HostValue *v = value_for(key);
+    if (!v || !v->used) return -1;
+    int n = v->len < buffer_size ? v->len : (int)buffer_size;
+    memcpy(buffer, v->data, n);
+    s_persist.bytes_read += n;
+    return n;
+}
+
+int persist_write_data(uint32_t key, const void *data, size_t size) {
+    s_persist.writes++;
+    HostValue *v = value_for(key);
+    if (!v || key - s_fail_first < s_fail_count) return -1;
+    if (size > PERSIST_DATA_MAX_LENGTH) size = PERSIST_DATA_MAX_LENGTH;
+    v->used = true;
+    v->len = size;
+    memcpy(v->data, data, size);
+    s_persist.bytes_written += size;
+    return size;
+}
+
+int persist_delete(uint32_t key) {
+    s_persist.deletes++;
+    HostValue *v = value_for(key);
+    if (v) v->used = false;
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Time
+// ----------------------------------------------------------------------------
+
+uint16_t time_ms(time_t *t_utc, uint16_t *out_ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint16_t ms = (uint16_t)(ts.tv_nsec / 1000000);
+    if (t_utc) *t_utc = ts.tv_sec;
+    if (out_ms) *out_ms = ms;
+    return ms;
+}
+
+// ----------------------------------------------------------------------------
+// Host-only controls
+// ----------------------------------------------------------------------------
+
+GContext *host_screen_reset(void) {
+    if (!s_fb.data) {
+        s_fb.w = HOST_SCREEN_W;
+        s_fb.h = HOST_SCREEN_H;
+#if defined(PBL_BW)
+        s_fb.format = GBitmapFormat1Bit;
+#elif defined(PBL_ROUND)
+        s_fb.format = GBitmapFormat8BitCircular;
+        s_fb.round = true;
+#else
+        s_fb.format = GBitmapFormat8Bit;
+#endif
+        s_fb.stride = stride_for(s_fb.format, s_fb.w);
+        s_fb.data = malloc(s_fb.stride * s_fb.h);
+        s_ctx.fb = &s_fb;
+    }
+    memset(s_fb.data, 0xFF, s_fb.stride * s_fb.h);   // white in both formats
+    s_ctx.fill = GColorBlack;
+    return &s_ctx;
+}
+
+void host_set_frame_buffer_enabled(bool enabled) { s_fb_enabled = enabled; }
+HostGfxStats *host_gfx_stats(void) { return &s_gfx; }
+HostPersistStats *host_persist_stats(void) { return &s_persist; }
+
+void host_persist_clear(void) {
+    if (s_values) memset(s_values, 0, HOST_PERSIST_KEYS * sizeof(HostValue));
+    memset(&s_persist, 0, sizeof(s_persist));
+}
+
+void host_persist_fail_writes(uint32_t first, uint32_t count) {
+    s_fail_first = first;
+    s_fail_count = count;
+}
+
+GSize host_screen_size(void) { return GSize(HOST_SCREEN_W, HOST_SCREEN_H); }
+
+int host_screen_pbm_size(void) { return ((HOST_SCREEN_W + 7) / 8) * HOST_SCREEN_H; }
+
+void host_screen_pbm(uint8_t *out) {
+    int row_bytes = (HOST_SCREEN_W + 7) / 8;
+    memset(out, 0, host_screen_pbm_size());
+    for (int y = 0; y < s_fb.h; y++) {
+        for (int x = 0; x < s_fb.w; x++) {
+            if (pixel_black(&s_fb, x, y)) out[y * row_bytes + (x >> 3)] |= (uint8_t)(0x80 >> (x & 7));
+        }
+    }
+}